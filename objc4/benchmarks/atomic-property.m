@@ -0,0 +1,202 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  atomic-property
+  Atomic property reads with one writer and many readers.
+
+  usage: atomic-property [max readers] [seconds per step]
+
+  build: xcrun clang -O2 -fno-objc-arc atomic-property.m -lobjc
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH, and
+  against the previous build for comparison.
+
+  One thread keeps writing a property while the readers keep reading
+  it, up to 63 readers. The rows are:
+  object  objc_setProperty/objc_getProperty with atomic=YES, the
+          writer switching between two objects
+  struct  objc_copyStruct with atomic=YES on a 32-byte struct. The
+          writer stores four copies of one counter, and the readers
+          check that all four match. A mismatch is a torn read.
+*/
+
+#include <objc/runtime.h>
+#include <objc/NSObject.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// From objc-abi.h and objc-internal.h, which the SDK does not ship.
+OBJC_EXPORT id objc_getProperty(id self, SEL _cmd, ptrdiff_t offset,
+                                BOOL atomic);
+OBJC_EXPORT void objc_setProperty(id self, SEL _cmd, ptrdiff_t offset,
+                                  id newValue, BOOL atomic,
+                                  signed char shouldCopy);
+OBJC_EXPORT void objc_copyStruct(void *dest, const void *src, ptrdiff_t size,
+                                 BOOL atomic, BOOL hasStrong);
+OBJC_EXPORT void *objc_autoreleasePoolPush(void);
+OBJC_EXPORT void objc_autoreleasePoolPop(void *context);
+
+struct quad {
+    uint64_t a, b, c, d;
+};
+
+@interface Holder : NSObject {
+    id value;
+    struct quad quad;
+}
+@end
+@implementation Holder
+@end
+
+static id holder;
+static ptrdiff_t valueOffset;
+static ptrdiff_t quadOffset;
+static SEL valueSel;
+static id values[2];
+
+static volatile bool stop;
+
+enum mode { OBJECT, STRUCT };
+
+struct worker {
+    pthread_t thread;
+    enum mode mode;
+    uint64_t ops;
+    uint64_t torn;
+};
+
+static struct quad *holderQuad(void)
+{
+    return (struct quad *)((char *)holder + quadOffset);
+}
+
+static void *writer(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    uint64_t ops = 0;
+    while (!stop) {
+        if (w->mode == OBJECT) {
+            objc_setProperty(holder, valueSel, valueOffset,
+                             values[ops & 1], YES, 0);
+        } else {
+            struct quad q = { ops, ops, ops, ops };
+            objc_copyStruct(holderQuad(), &q, sizeof(q), YES, NO);
+        }
+        ops++;
+    }
+    w->ops = ops;
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    uint64_t ops = 0;
+    uint64_t torn = 0;
+    while (!stop) {
+        if (w->mode == OBJECT) {
+            void *pool = objc_autoreleasePoolPush();
+            for (int i = 0; i < 1000; i++) {
+                id obj = objc_getProperty(holder, valueSel, valueOffset, YES);
+                if (obj != values[0]  &&  obj != values[1]) abort();
+            }
+            objc_autoreleasePoolPop(pool);
+        } else {
+            for (int i = 0; i < 1000; i++) {
+                struct quad q;
+                objc_copyStruct(&q, holderQuad(), sizeof(q), YES, NO);
+                if (q.a != q.b  ||  q.a != q.c  ||  q.a != q.d) torn++;
+            }
+        }
+        ops += 1000;
+    }
+    w->ops = ops;
+    w->torn = torn;
+    return NULL;
+}
+
+static void run(enum mode mode, unsigned readers, unsigned seconds)
+{
+    struct worker *workers = calloc(readers + 1, sizeof(*workers));
+
+    stop = false;
+    for (unsigned i = 0; i <= readers; i++) {
+        workers[i].mode = mode;
+        pthread_create(&workers[i].thread, NULL,
+                       i == 0 ? writer : reader, &workers[i]);
+    }
+    sleep(seconds);
+    stop = true;
+
+    uint64_t reads = 0, torn = 0;
+    for (unsigned i = 0; i <= readers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (i > 0) {
+            reads += workers[i].ops;
+            torn += workers[i].torn;
+        }
+    }
+    uint64_t writes = workers[0].ops;
+    free(workers);
+
+    printf("%-6s %2u readers  %9.2f M reads/s  %7.2f M/s per reader  "
+           "%7.2f M writes/s", mode == OBJECT ? "object" : "struct",
+           readers, reads / 1e6 / seconds, reads / 1e6 / seconds / readers,
+           writes / 1e6 / seconds);
+    if (mode == STRUCT) printf("  %llu torn", torn);
+    printf("\n");
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned maxReaders = argc > 1 ? (unsigned)atoi(argv[1]) : 63;
+    unsigned seconds = argc > 2 ? (unsigned)atoi(argv[2]) : 2;
+    if (maxReaders == 0  ||  seconds == 0) {
+        fprintf(stderr, "usage: atomic-property [max readers] "
+                "[seconds per step]\n");
+        return 1;
+    }
+
+    holder = [Holder new];
+    valueOffset = ivar_getOffset(class_getInstanceVariable([Holder class],
+                                                           "value"));
+    quadOffset = ivar_getOffset(class_getInstanceVariable([Holder class],
+                                                          "quad"));
+    valueSel = sel_registerName("value");
+    values[0] = [NSObject new];
+    values[1] = [NSObject new];
+    objc_setProperty(holder, valueSel, valueOffset, values[0], YES, 0);
+
+    // 1 writer and 1, 3, 7, ... readers, so the thread counts are
+    // powers of two and the last row is 1 writer and 63 readers.
+    for (int m = OBJECT; m <= STRUCT; m++) {
+        for (unsigned readers = 1; readers <= maxReaders;
+             readers = readers * 2 + 1)
+        {
+            run((enum mode)m, readers, seconds);
+        }
+    }
+    return 0;
+}
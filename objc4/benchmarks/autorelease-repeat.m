@@ -0,0 +1,146 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  autorelease-repeat
+  Autorelease pool pages and pop latency when the same objects are
+  autoreleased many times in one pool.
+
+  usage: autorelease-repeat [rounds]
+
+  build: xcrun clang -O2 -fno-objc-arc autorelease-repeat.m -lobjc
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH, once
+  as is and once with OBJC_DISABLE_AUTORELEASE_COALESCING=YES to get
+  the before numbers.
+
+  Each row pushes a pool, autoreleases n times, and pops, repeated for
+  the given number of rounds. Pages are counted in the first round from
+  the growth of the default malloc zone while the pool is full. Each
+  row runs on a new thread, so no retired pages are cached yet.
+  Patterns:
+  same       one object n times
+  alternate  two objects in turn, which coalescing cannot help
+  distinct   n different objects
+*/
+
+#include <objc/runtime.h>
+#include <objc/NSObject.h>
+#include <malloc/malloc.h>
+#include <mach/mach_time.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// From objc-internal.h, which the SDK does not ship.
+OBJC_EXPORT void *objc_autoreleasePoolPush(void);
+OBJC_EXPORT void objc_autoreleasePoolPop(void *context);
+
+static double ticksToNs;
+
+enum pattern { SAME, ALTERNATE, DISTINCT };
+static const char *patternNames[] = { "same", "alternate", "distinct" };
+
+static size_t heapInUse(void)
+{
+    malloc_statistics_t stats;
+    malloc_zone_statistics(malloc_default_zone(), &stats);
+    return stats.size_in_use;
+}
+
+struct row {
+    enum pattern pattern;
+    unsigned n;
+    unsigned rounds;
+};
+
+static void *run(void *arg)
+{
+    struct row *row = (struct row *)arg;
+    enum pattern pattern = row->pattern;
+    unsigned n = row->n;
+    unsigned rounds = row->rounds;
+
+    id *objs = calloc(n, sizeof(id));
+    for (unsigned i = 0; i < n; i++) {
+        objs[i] = (pattern == DISTINCT  ||  i < 2) ? [NSObject new] : nil;
+    }
+
+    double popNs = 0;
+    double pages = 0;
+    for (unsigned r = 0; r < rounds; r++) {
+        size_t before = heapInUse();
+        void *pool = objc_autoreleasePoolPush();
+        for (unsigned i = 0; i < n; i++) {
+            id obj;
+            switch (pattern) {
+            case SAME:      obj = objs[0]; break;
+            case ALTERNATE: obj = objs[i & 1]; break;
+            default:        obj = objs[i]; break;
+            }
+            [[obj retain] autorelease];
+        }
+        size_t full = heapInUse();
+
+        uint64_t start = mach_absolute_time();
+        objc_autoreleasePoolPop(pool);
+        popNs += (mach_absolute_time() - start) * ticksToNs;
+
+        if (r == 0  &&  full > before) {
+            pages = (double)(full - before) / PAGE_MAX_SIZE;
+        }
+    }
+
+    for (unsigned i = 0; i < n; i++) [objs[i] release];
+    free(objs);
+
+    printf("%-9s n=%8u  %8.1f pages  pop %10.1f us  %6.2f ns/entry\n",
+           patternNames[pattern], n, pages,
+           popNs / rounds / 1000.0, popNs / rounds / n);
+    return NULL;
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned rounds = argc > 1 ? (unsigned)atoi(argv[1]) : 20;
+    if (rounds == 0) {
+        fprintf(stderr, "usage: autorelease-repeat [rounds]\n");
+        return 1;
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    ticksToNs = (double)tb.numer / tb.denom;
+
+    const char *disabled = getenv("OBJC_DISABLE_AUTORELEASE_COALESCING");
+    printf("OBJC_DISABLE_AUTORELEASE_COALESCING=%s\n", 
+           disabled ? disabled : "(unset)");
+    for (int p = SAME; p <= DISTINCT; p++) {
+        for (unsigned n = 1000; n <= 1000000; n *= 10) {
+            struct row row = { (enum pattern)p, n, rounds };
+            pthread_t thread;
+            pthread_create(&thread, NULL, run, &row);
+            pthread_join(thread, NULL);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  block-trampolines
+  Creating, looking up, and removing many block IMPs.
+
+  usage: block-trampolines [trampolines]
+
+  build: xcrun clang -O2 -fno-objc-arc block-trampolines.m -lobjc
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH, and
+  against the previous build for comparison. The previous build walks
+  every trampoline page on each lookup and removal, so its rows take
+  much longer at the default of 1M trampolines; pass a smaller count.
+
+  Each row creates n trampolines with imp_implementationWithBlock(),
+  looks every one up with imp_getBlock() in random order, then removes
+  them with imp_removeBlock() in random order. The churn row then keeps
+  n/2 trampolines alive while creating and removing random ones, which
+  leaves holes in many pages. The "struct" rows use blocks that return
+  a large struct, which get trampolines of their own where the
+  architecture returns structs in memory.
+*/
+
+#include <objc/runtime.h>
+#include <mach/mach_time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static double ticksToNs;
+
+struct big {
+    uintptr_t words[8];
+};
+
+typedef uintptr_t (^plain_block_t)(id self);
+typedef struct big (^struct_block_t)(id self);
+
+static IMP create(uintptr_t i, bool structReturn)
+{
+    if (structReturn) {
+        return imp_implementationWithBlock(^(id self __unused) {
+            struct big b = { { i } };
+            return b;
+        });
+    }
+    return imp_implementationWithBlock(^(id self __unused) { return i; });
+}
+
+static uintptr_t identify(IMP imp, bool structReturn)
+{
+    id block = imp_getBlock(imp);
+    if (structReturn) return ((struct_block_t)block)(nil).words[0];
+    return ((plain_block_t)block)(nil);
+}
+
+static void shuffle(uintptr_t *order, unsigned count)
+{
+    for (unsigned i = count; i > 1; i--) {
+        unsigned j = arc4random_uniform(i);
+        uintptr_t tmp = order[i-1];
+        order[i-1] = order[j];
+        order[j] = tmp;
+    }
+}
+
+static double nsSince(uint64_t start, unsigned count)
+{
+    return (mach_absolute_time() - start) * ticksToNs / count;
+}
+
+static void run(unsigned n, bool structReturn)
+{
+    const char *name = structReturn ? "struct" : "plain";
+    IMP *imps = calloc(n, sizeof(IMP));
+    uintptr_t *order = malloc(n * sizeof(uintptr_t));
+    for (unsigned i = 0; i < n; i++) order[i] = i;
+
+    uint64_t start = mach_absolute_time();
+    for (unsigned i = 0; i < n; i++) imps[i] = create(i, structReturn);
+    double createNs = nsSince(start, n);
+
+    shuffle(order, n);
+    start = mach_absolute_time();
+    for (unsigned i = 0; i < n; i++) {
+        if (identify(imps[order[i]], structReturn) != order[i]) abort();
+    }
+    double getNs = nsSince(start, n);
+
+    shuffle(order, n);
+    start = mach_absolute_time();
+    for (unsigned i = 0; i < n; i++) {
+        if (!imp_removeBlock(imps[order[i]])) abort();
+        imps[order[i]] = NULL;
+    }
+    double removeNs = nsSince(start, n);
+
+    printf("%-6s %8u  create %7.1f ns  getBlock %7.1f ns  "
+           "removeBlock %7.1f ns\n", name, n, createNs, getNs, removeNs);
+
+    // Churn: half the slots live, then replace random slots.
+    for (unsigned i = 0; i < n; i += 2) imps[i] = create(i, structReturn);
+    start = mach_absolute_time();
+    for (unsigned i = 0; i < n; i++) {
+        unsigned slot = arc4random_uniform(n);
+        if (imps[slot]) {
+            if (identify(imps[slot], structReturn) != slot) abort();
+            if (!imp_removeBlock(imps[slot])) abort();
+            imps[slot] = NULL;
+        } else {
+            imps[slot] = create(slot, structReturn);
+        }
+    }
+    double churnNs = nsSince(start, n);
+    printf("%-6s %8u  churn  %7.1f ns per create or remove\n",
+           name, n, churnNs);
+
+    for (unsigned i = 0; i < n; i++) {
+        if (imps[i]) imp_removeBlock(imps[i]);
+    }
+    free(order);
+    free(imps);
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned n = argc > 1 ? (unsigned)atoi(argv[1]) : 1000000;
+    if (n == 0) {
+        fprintf(stderr, "usage: block-trampolines [trampolines]\n");
+        return 1;
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    ticksToNs = (double)tb.numer / tb.denom;
+
+    run(n, false);
+    run(n, true);
+    return 0;
+}
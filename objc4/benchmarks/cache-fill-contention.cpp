@@ -0,0 +1,418 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  cache-fill-contention
+  Concurrent method cache fills and lookups across many threads.
+
+  usage: cache-fill-contention [-t threads] [-s seconds] [-c classes]
+                               [-n selectors] [-f flushes/sec]
+                               [-p scan ns per thread]
+
+  build: c++ -O2 -std=c++11 -pthread cache-fill-contention.cpp
+
+  The runtime itself does not build on Linux, so this is a model of the
+  method cache locking in runtime/objc-cache.mm. It uses the same bucket
+  layout, fill rules, and garbage threshold. Each lookup marks its thread
+  as inside a cache reader, which stands in for the objc_msgSend PC
+  ranges that _collecting_in_critical() checks. Reading another thread's
+  PC costs a thread_get_state() call on Darwin; -p sets the simulated
+  cost of each per-thread check.
+
+  Two collection schemes run back to back:
+  locked    cache_collect(false) under the fill lock after each expansion
+            and flush, as objc4 did before.
+  unlocked  cache_collect_unlocked(): detach the garbage as a batch under
+            the lock, then scan and free without it, as objc4 does now.
+
+  Reported per scheme: lookups per second, and fill latency percentiles
+  including the time spent waiting for the lock.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+typedef uint32_t mask_t;
+
+struct bucket_t {
+    std::atomic<uintptr_t> key;
+    std::atomic<uintptr_t> imp;
+};
+
+struct buckets_t {
+    mask_t mask;
+    bucket_t b[1];
+};
+
+struct cache_t {
+    std::atomic<buckets_t *> buckets;
+    mask_t occupied;
+};
+
+enum { INIT_CACHE_SIZE = 4 };
+static const size_t garbage_threshold = 32*1024;
+static const unsigned GARBAGE_BATCH_RETRIES = 4;
+
+static std::mutex cacheUpdateLock;
+static std::vector<buckets_t *> garbage_refs;
+static std::atomic<size_t> garbage_byte_size;
+
+// Padded so that readers do not share cache lines.
+struct reader_t {
+    std::atomic<bool> inCritical;
+    char pad[63];
+};
+static reader_t *readers;
+static unsigned readerCount;
+static unsigned scanNanoseconds;
+
+static bool unlockedCollect;
+static std::atomic<bool> stop;
+static std::atomic<uint64_t> collections;
+
+
+static size_t bytesForCapacity(mask_t capacity)
+{
+    return sizeof(buckets_t) + (capacity - 1) * sizeof(bucket_t);
+}
+
+static buckets_t *allocateBuckets(mask_t capacity)
+{
+    buckets_t *b = (buckets_t *)calloc(1, bytesForCapacity(capacity));
+    b->mask = capacity - 1;
+    return b;
+}
+
+static mask_t hashFor(uintptr_t key, mask_t mask)
+{
+    return (mask_t)(key & mask);
+}
+
+static void spinFor(unsigned ns)
+{
+    if (!ns) return;
+    auto end = steady_clock::now() + nanoseconds(ns);
+    while (steady_clock::now() < end) { }
+}
+
+// The _collecting_in_critical() stand-in.
+static bool collectingInCritical()
+{
+    for (unsigned i = 0; i < readerCount; i++) {
+        spinFor(scanNanoseconds);
+        if (readers[i].inCritical.load(std::memory_order_seq_cst)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void freeAll(std::vector<buckets_t *>& refs)
+{
+    for (buckets_t *b : refs) free(b);
+    refs.clear();
+}
+
+
+// Locking: cacheUpdateLock must be held
+static void collectFree(buckets_t *old)
+{
+    garbage_refs.push_back(old);
+    garbage_byte_size += bytesForCapacity(old->mask + 1);
+}
+
+// cache_collect(false). Locking: cacheUpdateLock must be held
+static void collectLocked()
+{
+    if (garbage_byte_size < garbage_threshold) return;
+    if (collectingInCritical()) return;
+    freeAll(garbage_refs);
+    garbage_byte_size = 0;
+    collections++;
+}
+
+// cache_collect_unlocked(). Locking: cacheUpdateLock must NOT be held
+static void collectUnlocked()
+{
+    if (garbage_byte_size.load(std::memory_order_relaxed) < 
+        garbage_threshold) 
+    {
+        return;
+    }
+
+    std::vector<buckets_t *> batch;
+    size_t batchBytes;
+    {
+        std::lock_guard<std::mutex> lock(cacheUpdateLock);
+        if (garbage_byte_size < garbage_threshold) return;
+        batch.swap(garbage_refs);
+        batchBytes = garbage_byte_size.exchange(0);
+    }
+
+    for (unsigned tries = 0; collectingInCritical(); tries++) {
+        if (tries == GARBAGE_BATCH_RETRIES) {
+            std::lock_guard<std::mutex> lock(cacheUpdateLock);
+            garbage_refs.insert(garbage_refs.end(), 
+                                batch.begin(), batch.end());
+            garbage_byte_size += batchBytes;
+            return;
+        }
+        sched_yield();
+    }
+
+    freeAll(batch);
+    collections++;
+}
+
+
+static void reallocate(cache_t *cache, mask_t newCapacity)
+{
+    buckets_t *old = cache->buckets.load(std::memory_order_relaxed);
+    cache->buckets.store(allocateBuckets(newCapacity),
+                         std::memory_order_release);
+    cache->occupied = 0;
+    collectFree(old);
+    if (!unlockedCollect) collectLocked();
+}
+
+static void fill(cache_t *cache, uintptr_t key, uintptr_t imp)
+{
+    {
+        std::lock_guard<std::mutex> lock(cacheUpdateLock);
+
+        buckets_t *b = cache->buckets.load(std::memory_order_relaxed);
+        mask_t capacity = b->mask + 1;
+        mask_t newOccupied = cache->occupied + 1;
+        if (newOccupied > capacity / 4 * 3) {
+            reallocate(cache, capacity * 2);
+            b = cache->buckets.load(std::memory_order_relaxed);
+        }
+
+        mask_t i = hashFor(key, b->mask);
+        while (true) {
+            uintptr_t k = b->b[i].key.load(std::memory_order_relaxed);
+            if (k == key) break;
+            if (k == 0) {
+                // imp first, then key, as bucket_t::set does.
+                b->b[i].imp.store(imp, std::memory_order_relaxed);
+                b->b[i].key.store(key, std::memory_order_release);
+                cache->occupied++;
+                break;
+            }
+            i = (i + 1) & b->mask;
+        }
+    }
+    if (unlockedCollect) collectUnlocked();
+}
+
+static void flush(cache_t *cache)
+{
+    {
+        std::lock_guard<std::mutex> lock(cacheUpdateLock);
+        buckets_t *b = cache->buckets.load(std::memory_order_relaxed);
+        // Flushing must not shrink the mask.
+        reallocate(cache, b->mask + 1);
+    }
+    if (unlockedCollect) collectUnlocked();
+}
+
+// The objc_msgSend cache probe.
+static bool lookup(reader_t *self, cache_t *cache, uintptr_t key)
+{
+    self->inCritical.store(true, std::memory_order_seq_cst);
+    buckets_t *b = cache->buckets.load(std::memory_order_acquire);
+    mask_t mask = b->mask;
+    mask_t i = hashFor(key, mask);
+    bool hit = false;
+    while (true) {
+        uintptr_t k = b->b[i].key.load(std::memory_order_acquire);
+        if (k == key) {
+            hit = (b->b[i].imp.load(std::memory_order_relaxed) == (key ^ 1));
+            break;
+        }
+        if (k == 0) break;
+        i = (i + 1) & mask;
+    }
+    self->inCritical.store(false, std::memory_order_release);
+    return hit;
+}
+
+
+struct result_t {
+    uint64_t lookups;
+    std::vector<uint32_t> fillNanoseconds;
+};
+
+static void worker(unsigned index, cache_t *caches, unsigned classCount,
+                   unsigned selectorCount, result_t *result)
+{
+    reader_t *self = &readers[index];
+    std::mt19937 rng(index * 7919 + 1);
+    // Mostly hot selectors, with a tail of cold ones.
+    std::uniform_int_distribution<unsigned> cls(0, classCount - 1);
+    std::uniform_int_distribution<unsigned> hot(1, 64);
+    std::uniform_int_distribution<unsigned> cold(1, selectorCount);
+    std::uniform_int_distribution<unsigned> pick(0, 99);
+
+    uint64_t lookups = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        cache_t *cache = &caches[cls(rng)];
+        uintptr_t key = (pick(rng) < 90 ? hot(rng) : cold(rng)) << 4;
+        if (!lookup(self, cache, key)) {
+            auto start = steady_clock::now();
+            fill(cache, key, key ^ 1);
+            auto ns = duration_cast<nanoseconds>(steady_clock::now() - start);
+            result->fillNanoseconds.push_back((uint32_t)
+                std::min<int64_t>(ns.count(), UINT32_MAX));
+        }
+        lookups++;
+    }
+    result->lookups = lookups;
+}
+
+static void flusher(cache_t *caches, unsigned classCount, unsigned perSecond)
+{
+    if (!perSecond) return;
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<unsigned> cls(0, classCount - 1);
+    auto interval = microseconds(1000000 / perSecond);
+    while (!stop.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(interval);
+        flush(&caches[cls(rng)]);
+    }
+}
+
+
+static void run(const char *name, unsigned threadCount, unsigned seconds,
+                unsigned classCount, unsigned selectorCount,
+                unsigned flushesPerSecond)
+{
+    std::vector<cache_t> caches(classCount);
+    for (cache_t& c : caches) {
+        c.buckets = allocateBuckets(INIT_CACHE_SIZE);
+        c.occupied = 0;
+    }
+    stop = false;
+    collections = 0;
+
+    std::vector<result_t> results(threadCount);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < threadCount; i++) {
+        threads.emplace_back(worker, i, caches.data(), classCount,
+                             selectorCount, &results[i]);
+    }
+    std::thread flushThread(flusher, caches.data(), classCount,
+                            flushesPerSecond);
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (std::thread& t : threads) t.join();
+    flushThread.join();
+
+    uint64_t lookups = 0;
+    std::vector<uint32_t> fills;
+    for (result_t& r : results) {
+        lookups += r.lookups;
+        fills.insert(fills.end(), r.fillNanoseconds.begin(),
+                     r.fillNanoseconds.end());
+    }
+    std::sort(fills.begin(), fills.end());
+    auto pct = [&](double p) -> double {
+        if (fills.empty()) return 0;
+        return fills[std::min(fills.size() - 1,
+                              (size_t)(p * fills.size()))] / 1000.0;
+    };
+
+    printf("%-9s %12.0f lookups/s  %9zu fills  "
+           "fill us p50 %.2f p99 %.2f p99.9 %.2f max %.2f  "
+           "%llu collections\n",
+           name, (double)lookups / seconds, fills.size(),
+           pct(0.50), pct(0.99), pct(0.999),
+           fills.empty() ? 0.0 : fills.back() / 1000.0,
+           (unsigned long long)collections.load());
+
+    for (cache_t& c : caches) free(c.buckets.load());
+    freeAll(garbage_refs);
+    garbage_byte_size = 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned threadCount = 64;
+    unsigned seconds = 5;
+    unsigned classCount = 512;
+    unsigned selectorCount = 4096;
+    unsigned flushesPerSecond = 1000;
+    scanNanoseconds = 500;
+
+    int ch;
+    while ((ch = getopt(argc, argv, "t:s:c:n:f:p:")) != -1) {
+        unsigned value = (unsigned)strtoul(optarg, NULL, 0);
+        switch (ch) {
+        case 't': threadCount = value; break;
+        case 's': seconds = value; break;
+        case 'c': classCount = value; break;
+        case 'n': selectorCount = value; break;
+        case 'f': flushesPerSecond = value; break;
+        case 'p': scanNanoseconds = value; break;
+        default:
+            fprintf(stderr, "usage: cache-fill-contention [-t threads] "
+                    "[-s seconds] [-c classes] [-n selectors] "
+                    "[-f flushes/sec] [-p scan ns per thread]\n");
+            return 1;
+        }
+    }
+    if (!threadCount || !seconds || !classCount || !selectorCount) {
+        fprintf(stderr, "cache-fill-contention: counts must be non-zero\n");
+        return 1;
+    }
+
+    readerCount = threadCount;
+    readers = new reader_t[threadCount]();
+
+    printf("%u threads, %u classes, %u selectors, %u flushes/s, "
+           "%u ns per thread scanned\n", threadCount, classCount,
+           selectorCount, flushesPerSecond, scanNanoseconds);
+
+    unlockedCollect = false;
+    run("locked", threadCount, seconds, classCount, selectorCount,
+        flushesPerSecond);
+    unlockedCollect = true;
+    run("unlocked", threadCount, seconds, classCount, selectorCount,
+        flushesPerSecond);
+
+    delete[] readers;
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  cache-resize
+  Method cache refill cost and bucket memory across repeated flushes.
+
+  usage: cache-resize [flushes]
+
+  build: xcrun clang -O2 -fno-objc-arc -Wno-deprecated-declarations \
+             cache-resize.m -lobjc
+
+  Run it with OBJC_DEBUG_CACHE_STATS=YES against the libobjc under
+  test with DYLD_LIBRARY_PATH, and against the previous build for
+  comparison. A libobjc without _objc_getCacheStats() gives times only.
+
+  There are two kinds of class:
+  big    use a working set of many selectors after every flush
+  small  were sent many selectors once, then only a couple
+  Each round flushes every cache, as loading a category does, and then
+  sends the working sets again. The refill time is mostly cache
+  reallocation for the big classes. The last rows show how many bucket
+  arrays the rounds allocated, how many caches shrank, and the bucket
+  memory live at the end, from the live cache counts per capacity.
+*/
+
+#include <objc/runtime.h>
+#include <objc/message.h>
+#include <objc/NSObject.h>
+#include <mach/mach_time.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// From objc-internal.h, which the SDK does not ship.
+struct objc_cache_stats {
+    size_t liveCaches[16];
+    size_t allocations;
+    size_t collections;
+    size_t shrinks;
+    size_t deferredShrinks;
+};
+
+enum {
+    BIG_CLASSES = 16,
+    BIG_SELECTORS = 1000,
+    SMALL_CLASSES = 1000,
+    SMALL_WARMUP_SELECTORS = 64,
+    SMALL_SELECTORS = 2,
+};
+
+static void dummy(id self __unused, SEL _cmd __unused) { }
+
+static SEL *makeSelectors(const char *prefix, unsigned count)
+{
+    SEL *sels = malloc(count * sizeof(SEL));
+    for (unsigned i = 0; i < count; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s%u", prefix, i);
+        sels[i] = sel_registerName(name);
+    }
+    return sels;
+}
+
+static id *makeInstances(const char *prefix, unsigned classes,
+                         SEL *sels, unsigned selectors)
+{
+    id *objs = malloc(classes * sizeof(id));
+    for (unsigned c = 0; c < classes; c++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s%u", prefix, c);
+        Class cls = objc_allocateClassPair([NSObject class], name, 0);
+        for (unsigned s = 0; s < selectors; s++) {
+            class_addMethod(cls, sels[s], (IMP)dummy, "v@:");
+        }
+        objc_registerClassPair(cls);
+        objs[c] = class_createInstance(cls, 0);
+    }
+    return objs;
+}
+
+static void sendAll(id *objs, unsigned classes, SEL *sels, unsigned selectors)
+{
+    void (*send)(id, SEL) = (void (*)(id, SEL))objc_msgSend;
+    for (unsigned c = 0; c < classes; c++) {
+        for (unsigned s = 0; s < selectors; s++) send(objs[c], sels[s]);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned rounds = argc > 1 ? (unsigned)atoi(argv[1]) : 100;
+    if (rounds == 0) {
+        fprintf(stderr, "usage: cache-resize [flushes]\n");
+        return 1;
+    }
+
+    void (*getStats)(struct objc_cache_stats *) =
+        (void (*)(struct objc_cache_stats *))
+        dlsym(RTLD_DEFAULT, "_objc_getCacheStats");
+    if (getStats  &&  !getenv("OBJC_DEBUG_CACHE_STATS")) {
+        fprintf(stderr, "cache-resize: set OBJC_DEBUG_CACHE_STATS=YES "
+                "to get cache counts\n");
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    double ticksToNs = (double)tb.numer / tb.denom;
+
+    SEL *bigSels = makeSelectors("cacheResizeBig", BIG_SELECTORS);
+    SEL *smallSels = makeSelectors("cacheResizeSmall", SMALL_WARMUP_SELECTORS);
+    id *big = makeInstances("CacheResizeBig", BIG_CLASSES,
+                            bigSels, BIG_SELECTORS);
+    id *small = makeInstances("CacheResizeSmall", SMALL_CLASSES,
+                              smallSels, SMALL_WARMUP_SELECTORS);
+
+    sendAll(big, BIG_CLASSES, bigSels, BIG_SELECTORS);
+    sendAll(small, SMALL_CLASSES, smallSels, SMALL_WARMUP_SELECTORS);
+
+    struct objc_cache_stats before, after;
+    memset(&before, 0, sizeof(before));
+    memset(&after, 0, sizeof(after));
+    if (getStats) getStats(&before);
+
+    uint64_t bigTicks = 0, smallTicks = 0;
+    for (unsigned r = 0; r < rounds; r++) {
+        _objc_flush_caches(Nil);
+
+        uint64_t start = mach_absolute_time();
+        sendAll(big, BIG_CLASSES, bigSels, BIG_SELECTORS);
+        uint64_t mid = mach_absolute_time();
+        sendAll(small, SMALL_CLASSES, smallSels, SMALL_SELECTORS);
+        uint64_t end = mach_absolute_time();
+
+        bigTicks += mid - start;
+        smallTicks += end - mid;
+    }
+
+    if (getStats) getStats(&after);
+
+    printf("refill big   %3u classes x %4u selectors  %9.1f us/flush  "
+           "%6.1f ns/send\n", BIG_CLASSES, BIG_SELECTORS,
+           bigTicks * ticksToNs / rounds / 1000.0,
+           bigTicks * ticksToNs / rounds / (BIG_CLASSES * BIG_SELECTORS));
+    printf("refill small %3u classes x %4u selectors  %9.1f us/flush  "
+           "%6.1f ns/send\n", SMALL_CLASSES, SMALL_SELECTORS,
+           smallTicks * ticksToNs / rounds / 1000.0,
+           smallTicks * ticksToNs / rounds
+           / (SMALL_CLASSES * SMALL_SELECTORS));
+
+    if (!getStats) return 0;
+
+    // A bucket is a SEL and an IMP.
+    size_t bucketBytes = 0;
+    for (unsigned i = 0; i < 16; i++) {
+        bucketBytes += after.liveCaches[i] * ((size_t)1 << i) * 2*sizeof(void*);
+    }
+    printf("bucket arrays allocated  %8.1f per flush\n",
+           (double)(after.allocations - before.allocations) / rounds);
+    printf("shrinks %zu  deferred shrinks %zu  collections %zu\n",
+           after.shrinks - before.shrinks,
+           after.deferredShrinks - before.deferredShrinks,
+           after.collections - before.collections);
+    printf("live bucket memory at end  %zu KB\n", bucketBytes / 1024);
+    return 0;
+}
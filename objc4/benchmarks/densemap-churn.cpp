@@ -0,0 +1,219 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  densemap-churn
+  Insert/erase churn on the runtime's RefcountMap.
+
+  usage: densemap-churn [-n pairs] [-l live keys] [-r report interval]
+
+  build (macOS): clang++ -O2 -std=c++11 densemap-churn.cpp
+  build (Linux): c++ -O2 -std=c++11 -Ilinux densemap-churn.cpp
+
+  Compiles runtime/llvm-DenseMap.h directly, keyed and valued like 
+  each SideTable's RefcountMap. A fixed number of keys is live at a 
+  time. Each step erases the oldest live key and inserts a new one, as 
+  objects that overflowed their inline retain count come and go. 
+  Lookups of the live keys run at each report, the way 
+  sidetable_retainCount and rootRelease_underflow probe the map.
+
+  The default is one billion insert/erase pairs. Each report prints 
+  the time per pair and per lookup over the last interval, and the 
+  map's memory. Tombstones that are never compacted show up as lookup 
+  time growing over the run.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+// Stand-ins for the parts of objc-private.h that the DenseMap headers 
+// use, copied from it. Defining its include guard keeps the real one 
+// (and its Darwin-only headers) out.
+#define _OBJC_PRIVATE_H_
+
+#ifndef __has_feature
+#define __has_feature(x) 0
+#endif
+
+#if __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#define malloc_size(p) malloc_usable_size((void *)(p))
+#endif
+
+struct objc_object { };
+
+static void _objc_fatal(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    abort();
+}
+
+static inline uint32_t _objc_strhash(const char *s) {
+    uint32_t hash = 0;
+    for (;;) {
+        int a = *s++;
+        if (0 == a) break;
+        hash += (hash << 8) + a;
+    }
+    return hash;
+}
+
+template <typename T>
+class DisguisedPtr {
+    uintptr_t value;
+
+    static uintptr_t disguise(T* ptr) {
+        return -(uintptr_t)ptr;
+    }
+
+    static T* undisguise(uintptr_t val) {
+        return (T*)-val;
+    }
+
+ public:
+    DisguisedPtr() { }
+    DisguisedPtr(T* ptr) 
+        : value(disguise(ptr)) { }
+    DisguisedPtr(const DisguisedPtr<T>& ptr) 
+        : value(ptr.value) { }
+
+    DisguisedPtr<T>& operator = (T* rhs) {
+        value = disguise(rhs);
+        return *this;
+    }
+    DisguisedPtr<T>& operator = (const DisguisedPtr<T>& rhs) {
+        value = rhs.value;
+        return *this;
+    }
+
+    operator T* () const {
+        return undisguise(value);
+    }
+};
+
+#if __LP64__
+static inline uint32_t ptr_hash(uint64_t key)
+{
+    key ^= key >> 4;
+    key *= 0x8a970be7488fda55;
+    key ^= __builtin_bswap64(key);
+    return (uint32_t)key;
+}
+#else
+static inline uint32_t ptr_hash(uint32_t key)
+{
+    key ^= key >> 4;
+    key *= 0x5052acdb;
+    key ^= __builtin_bswap32(key);
+    return key;
+}
+#endif
+
+#include "../runtime/llvm-DenseMap.h"
+
+typedef objc::DenseMap<DisguisedPtr<objc_object>,size_t,true> RefcountMap;
+
+using namespace std::chrono;
+
+
+// Object-like addresses: 16-byte aligned, spread over a heap-sized range.
+static objc_object *keyFor(uint64_t i)
+{
+    uint64_t x = i * 0x9e3779b97f4a7c15ULL;
+    x ^= x >> 29;
+    return (objc_object *)(uintptr_t)(0x100000000ULL + (x & 0xffffffff0ULL));
+}
+
+
+int main(int argc, char **argv)
+{
+    uint64_t pairs = 1000000000ULL;
+    uint64_t liveCount = 10000;
+    uint64_t reportInterval = 100000000ULL;
+
+    int ch;
+    while ((ch = getopt(argc, argv, "n:l:r:")) != -1) {
+        uint64_t value = strtoull(optarg, NULL, 0);
+        switch (ch) {
+        case 'n': pairs = value; break;
+        case 'l': liveCount = value; break;
+        case 'r': reportInterval = value; break;
+        default:
+            fprintf(stderr, "usage: densemap-churn [-n pairs] "
+                    "[-l live keys] [-r report interval]\n");
+            return 1;
+        }
+    }
+    if (!liveCount  ||  !reportInterval) {
+        fprintf(stderr, "densemap-churn: counts must be non-zero\n");
+        return 1;
+    }
+
+    RefcountMap refcnts;
+    for (uint64_t i = 0; i < liveCount; i++) {
+        refcnts[keyFor(i)] = 2;
+    }
+
+    printf("%llu insert/erase pairs, %llu live keys\n", 
+           (unsigned long long)pairs, (unsigned long long)liveCount);
+
+    uint64_t next = liveCount;
+    volatile size_t sink = 0;
+    auto intervalStart = steady_clock::now();
+    for (uint64_t done = 0; done < pairs; ) {
+        uint64_t end = done + reportInterval;
+        if (end > pairs) end = pairs;
+        for (; done < end; done++, next++) {
+            refcnts.erase(keyFor(next - liveCount));
+            refcnts[keyFor(next)] += 2;
+        }
+        auto churnEnd = steady_clock::now();
+
+        for (uint64_t i = next - liveCount; i < next; i++) {
+            sink += refcnts.lookup(keyFor(i));
+        }
+        auto lookupEnd = steady_clock::now();
+
+        double churnNs = 
+            duration_cast<nanoseconds>(churnEnd - intervalStart).count();
+        double lookupNs = 
+            duration_cast<nanoseconds>(lookupEnd - churnEnd).count();
+        printf("%12llu pairs  %6.1f ns/pair  %6.1f ns/lookup  "
+               "%8zu bytes  %u entries\n", (unsigned long long)done, 
+               churnNs / reportInterval, lookupNs / liveCount, 
+               refcnts.getMemorySize(), refcnts.size());
+        intervalStart = steady_clock::now();
+    }
+
+    return sink == 0;
+}
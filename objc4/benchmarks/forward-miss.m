@@ -0,0 +1,116 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  forward-miss
+  Cost of looking up a new selector that a proxy class forwards.
+
+  usage: forward-miss [selectors per row]
+
+  build: xcrun clang -O2 -fno-objc-arc forward-miss.m -lobjc
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH, and
+  against the previous build for comparison.
+
+  Each row builds a chain of depth classes under NSObject, each with
+  methods methods, and times class_respondsToSelector on the leaf for
+  selectors it has never seen. Each of those misses the method cache,
+  runs the method resolver, and ends in forwarding, like a proxy that
+  receives many dynamic selectors. The first few misses are not timed:
+  the negative lookup filter is only built after a class forwards 16
+  times.
+*/
+
+#include <objc/runtime.h>
+#include <objc/NSObject.h>
+#include <mach/mach_time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void dummy(id self __unused, SEL _cmd __unused) { }
+
+static unsigned classNumber;
+
+static Class makeChain(unsigned depth, unsigned methods)
+{
+    Class cls = [NSObject class];
+    for (unsigned d = 0; d < depth; d++) {
+        char name[64];
+        snprintf(name, sizeof(name), "ForwardMiss%u", classNumber++);
+        cls = objc_allocateClassPair(cls, name, 0);
+        for (unsigned m = 0; m < methods; m++) {
+            char sel[64];
+            snprintf(sel, sizeof(sel), "%s_method%u", name, m);
+            class_addMethod(cls, sel_registerName(sel), (IMP)dummy, "v@:");
+        }
+        objc_registerClassPair(cls);
+    }
+    return cls;
+}
+
+static void run(unsigned depth, unsigned methods, unsigned count)
+{
+    Class leaf = makeChain(depth, methods);
+
+    enum { WARMUP = 32 };
+    SEL *sels = malloc((count + WARMUP) * sizeof(SEL));
+    for (unsigned i = 0; i < count + WARMUP; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s_dynamic%u",
+                 class_getName(leaf), i);
+        sels[i] = sel_registerName(name);
+    }
+
+    for (unsigned i = 0; i < WARMUP; i++) {
+        if (class_respondsToSelector(leaf, sels[i])) abort();
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    uint64_t start = mach_absolute_time();
+    for (unsigned i = WARMUP; i < count + WARMUP; i++) {
+        if (class_respondsToSelector(leaf, sels[i])) abort();
+    }
+    uint64_t ticks = mach_absolute_time() - start;
+    free(sels);
+
+    printf("depth %2u  %5u methods/class  %8.1f ns/miss\n", depth, methods,
+           (double)ticks * tb.numer / tb.denom / count);
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 20000;
+    if (count == 0) {
+        fprintf(stderr, "usage: forward-miss [selectors per row]\n");
+        return 1;
+    }
+
+    unsigned depths[] = { 1, 4, 16 };
+    unsigned methods[] = { 10, 100, 1000 };
+    for (unsigned d = 0; d < sizeof(depths)/sizeof(depths[0]); d++) {
+        for (unsigned m = 0; m < sizeof(methods)/sizeof(methods[0]); m++) {
+            run(depths[d], methods[m], count);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  ivar-layout
+  object_getIvar/object_setIvar cost on ARC classes with many ivars.
+
+  usage: ivar-layout [passes]
+
+  build: xcrun clang -O2 -fobjc-arc ivar-layout.m -lobjc
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH, and
+  against the previous build for comparison.
+
+  object_getIvar and object_setIvar look up whether an ivar is strong,
+  weak or unretained in the class's ARC ivar layouts. The classes here
+  have 4, 64 and 256 ivars, a quarter each strong, weak, unretained
+  and int, so the layouts are long and mixed. Each row reports the
+  cost per call for one kind of ivar, and the cost of
+  class_getIvarLayout for the class.
+*/
+
+#include <objc/runtime.h>
+#include <objc/NSObject.h>
+#include <mach/mach_time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IVARS_4(p)                                                      \
+    id p##_strong;                                                      \
+    __weak id p##_weak;                                                 \
+    __unsafe_unretained id p##_unretained;                              \
+    int p##_int;
+#define IVARS_64(p)                                                     \
+    IVARS_4(p##0) IVARS_4(p##1) IVARS_4(p##2) IVARS_4(p##3)             \
+    IVARS_4(p##4) IVARS_4(p##5) IVARS_4(p##6) IVARS_4(p##7)             \
+    IVARS_4(p##8) IVARS_4(p##9) IVARS_4(p##a) IVARS_4(p##b)             \
+    IVARS_4(p##c) IVARS_4(p##d) IVARS_4(p##e) IVARS_4(p##f)
+#define IVARS_256(p)                                                    \
+    IVARS_64(p##0) IVARS_64(p##1) IVARS_64(p##2) IVARS_64(p##3)
+
+@interface Ivars4 : NSObject { IVARS_4(i) } @end
+@implementation Ivars4 @end
+@interface Ivars64 : NSObject { IVARS_64(i) } @end
+@implementation Ivars64 @end
+@interface Ivars256 : NSObject { IVARS_256(i) } @end
+@implementation Ivars256 @end
+
+static double ticksToNs;
+
+enum kind { STRONG, WEAK, UNRETAINED, KINDS };
+static const char *kindNames[] = { "strong", "weak", "unretained" };
+
+static enum kind kindOf(Ivar ivar)
+{
+    const char *name = ivar_getName(ivar);
+    if (strstr(name, "_strong")) return STRONG;
+    if (strstr(name, "_weak")) return WEAK;
+    if (strstr(name, "_unretained")) return UNRETAINED;
+    return KINDS;
+}
+
+static void run(Class cls, unsigned passes)
+{
+    id obj = [cls new];
+    id value = [NSObject new];
+
+    unsigned count;
+    Ivar *ivars = class_copyIvarList(cls, &count);
+    enum kind *kinds = malloc(count * sizeof(enum kind));
+    for (unsigned i = 0; i < count; i++) kinds[i] = kindOf(ivars[i]);
+
+    for (int k = STRONG; k < KINDS; k++) {
+        unsigned calls = 0;
+        uint64_t start = mach_absolute_time();
+        for (unsigned p = 0; p < passes; p++) {
+            for (unsigned i = 0; i < count; i++) {
+                if (kinds[i] != k) continue;
+                object_setIvar(obj, ivars[i], value);
+                __unsafe_unretained id got = object_getIvar(obj, ivars[i]);
+                if (got != value) abort();
+                calls += 2;
+            }
+        }
+        uint64_t ticks = mach_absolute_time() - start;
+        printf("%3u ivars  %-10s  %7.1f ns/call\n",
+               count, kindNames[k], ticks * ticksToNs / calls);
+    }
+
+    uint64_t start = mach_absolute_time();
+    for (unsigned p = 0; p < passes; p++) {
+        if (!class_getIvarLayout(cls)) abort();
+    }
+    printf("%3u ivars  class_getIvarLayout  %7.1f ns/call\n",
+           count, (mach_absolute_time() - start) * ticksToNs / passes);
+
+    free(kinds);
+    free(ivars);
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned passes = argc > 1 ? (unsigned)atoi(argv[1]) : 10000;
+    if (passes == 0) {
+        fprintf(stderr, "usage: ivar-layout [passes]\n");
+        return 1;
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    ticksToNs = (double)tb.numer / tb.denom;
+
+    run([Ivars4 class], passes);
+    run([Ivars64 class], passes);
+    run([Ivars256 class], passes);
+    return 0;
+}
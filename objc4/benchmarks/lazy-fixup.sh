@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# lazy-fixup.sh
+# Startup time and memory with and without lazy method list fixup.
+#
+# usage: lazy-fixup.sh [classes] [methods per class] [classes used]
+#
+# Generates a dylib with many classes, each with many methods. The 
+# driver stands in for a service that starts up, realizes all of its 
+# classes, and then handles a first request that messages only a few 
+# of them. It reports the time to realize every class (through 
+# objc_getClassList), the time to the end of the first request, and 
+# the resident and dirty memory after that.
+# Each configuration runs in a fresh process, with 
+# OBJC_LAZY_METHOD_LIST_FIXUP unset and set to YES. Run it against the 
+# libobjc under test with DYLD_LIBRARY_PATH.
+
+set -e
+
+CLASSES=${1:-2000}
+METHODS=${2:-40}
+USED=${3:-50}
+TMP=$(mktemp -d /tmp/lazy-fixup.XXXXXX)
+CC="xcrun clang -O2 -fno-objc-arc -Wno-objc-missing-super-calls"
+
+awk -v c="$CLASSES" -v m="$METHODS" 'BEGIN {
+    print "#include <objc/NSObject.h>"
+    for (i = 0; i < c; i++) {
+        printf "@interface LazyFixup%d : NSObject @end\n", i
+        printf "@implementation LazyFixup%d\n", i
+        for (j = 0; j < m; j++) printf "- (void)work%d { }\n", j
+        print "@end"
+    }
+}' > "$TMP/classes.m"
+$CC -dynamiclib "$TMP/classes.m" -lobjc -o "$TMP/libclasses.dylib"
+
+cat > "$TMP/driver.m" <<'DRIVER'
+#include <objc/runtime.h>
+#include <objc/message.h>
+#include <objc/NSObject.h>
+#include <dlfcn.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static double ms(uint64_t ticks)
+{
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    return (double)ticks * tb.numer / tb.denom / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned used = (unsigned)atoi(argv[2]);
+    uint64_t start = mach_absolute_time();
+
+    if (!dlopen(argv[1], RTLD_NOW)) {
+        fprintf(stderr, "%s\n", dlerror());
+        return 1;
+    }
+    int count = objc_getClassList(NULL, 0);
+    uint64_t realized = mach_absolute_time();
+
+    // The first request: a few methods of a few classes.
+    char name[64];
+    for (unsigned i = 0; i < used; i++) {
+        snprintf(name, sizeof(name), "LazyFixup%u", i);
+        id obj = [objc_getClass(name) new];
+        ((void (*)(id, SEL))objc_msgSend)(obj, sel_registerName("work0"));
+        ((void (*)(id, SEL))objc_msgSend)(obj, sel_registerName("work1"));
+        [obj release];
+    }
+    uint64_t firstRequest = mach_absolute_time();
+
+    task_vm_info_data_t info;
+    mach_msg_type_number_t infoCount = TASK_VM_INFO_COUNT;
+    task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &infoCount);
+
+    const char *lazy = getenv("OBJC_LAZY_METHOD_LIST_FIXUP");
+    printf("lazy=%-7s %d classes  realize all %8.2f ms  "
+           "first request done %8.2f ms  resident %6.1f MB  "
+           "footprint %6.1f MB\n", lazy ? lazy : "(unset)", count,
+           ms(realized - start), ms(firstRequest - start),
+           info.resident_size / 1048576.0, info.phys_footprint / 1048576.0);
+    return 0;
+}
+DRIVER
+$CC "$TMP/driver.m" -lobjc -o "$TMP/driver"
+
+for i in 1 2 3; do
+    "$TMP/driver" "$TMP/libclasses.dylib" "$USED"
+    OBJC_LAZY_METHOD_LIST_FIXUP=YES "$TMP/driver" "$TMP/libclasses.dylib" "$USED"
+done
+
+rm -rf "$TMP"
@@ -0,0 +1,5 @@
+/*
+ * Empty stand-in for Darwin's TargetConditionals.h, so that the 
+ * Linux-buildable benchmarks can include runtime headers that only 
+ * include it. See densemap-churn.cpp.
+ */
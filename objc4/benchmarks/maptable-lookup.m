@@ -0,0 +1,255 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  maptable-lookup
+  NXMapTable and NXHashTable lookup throughput and memory per entry.
+
+  usage: maptable-lookup [lookup passes]
+
+  build: xcrun clang -O2 -fno-objc-arc -Wno-deprecated-declarations \
+             maptable-lookup.m -lobjc -framework Foundation
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH, and
+  against the previous build for comparison.
+
+  The string keys are the method names of every class loaded with
+  Foundation, which share prefixes and suffixes the way the runtime's
+  selector and class names do. The pointer keys are the classes. Each
+  key set goes into an open-addressed NXMapTable and into a chained
+  NXHashTable. Rows report insert time, lookups that hit, lookups that
+  miss, and the bytes per entry the table allocated from its own
+  malloc zone.
+*/
+
+#include <objc/runtime.h>
+#include <objc/hashtable2.h>
+#include <malloc/malloc.h>
+#include <mach/mach_time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// From maptable.h, which the SDK does not ship.
+typedef struct _NXMapTable {
+    const struct _NXMapTablePrototype *prototype;
+    unsigned count;
+    unsigned nbBucketsMinusOne;
+    void *buckets;
+} NXMapTable;
+typedef struct _NXMapTablePrototype {
+    unsigned (*hash)(NXMapTable *, const void *key);
+    int (*isEqual)(NXMapTable *, const void *key1, const void *key2);
+    void (*free)(NXMapTable *, void *key, void *value);
+    int style;
+} NXMapTablePrototype;
+OBJC_EXPORT const NXMapTablePrototype NXPtrValueMapPrototype;
+OBJC_EXPORT const NXMapTablePrototype NXStrValueMapPrototype;
+OBJC_EXPORT NXMapTable *NXCreateMapTableFromZone(NXMapTablePrototype prototype,
+                                                 unsigned capacity, void *z);
+OBJC_EXPORT void NXFreeMapTable(NXMapTable *table);
+OBJC_EXPORT void *NXMapGet(NXMapTable *table, const void *key);
+OBJC_EXPORT void *NXMapInsert(NXMapTable *table, const void *key,
+                              const void *value);
+
+static double ticksToNs;
+static unsigned passes;
+
+struct keys {
+    const void **hits;
+    const void **misses;
+    unsigned count;
+};
+
+static void shuffle(const void **array, unsigned count)
+{
+    for (unsigned i = count; i > 1; i--) {
+        unsigned j = arc4random_uniform(i);
+        const void *tmp = array[i-1];
+        array[i-1] = array[j];
+        array[j] = tmp;
+    }
+}
+
+static struct keys stringKeys(void)
+{
+    NXHashTable *seen = NXCreateHashTable(NXStrPrototype, 0, NULL);
+    unsigned classCount;
+    Class *classes = objc_copyClassList(&classCount);
+    for (unsigned c = 0; c < classCount; c++) {
+        unsigned methodCount;
+        Method *methods = class_copyMethodList(classes[c], &methodCount);
+        for (unsigned m = 0; m < methodCount; m++) {
+            NXHashInsertIfAbsent(seen, sel_getName(method_getName(methods[m])));
+        }
+        free(methods);
+    }
+    free(classes);
+
+    struct keys keys;
+    keys.count = NXCountHashTable(seen);
+    keys.hits = malloc(keys.count * sizeof(void *));
+    keys.misses = malloc(keys.count * sizeof(void *));
+    NXHashState state = NXInitHashState(seen);
+    void *name;
+    unsigned i = 0;
+    while (NXNextHashState(seen, &state, &name)) {
+        keys.hits[i] = name;
+        // Same prefix, different last character: a miss that still
+        // compares most of the string on a hash collision.
+        char *miss = strdup((const char *)name);
+        miss[strlen(miss) - 1] ^= 0x80;
+        keys.misses[i] = miss;
+        i++;
+    }
+    NXFreeHashTable(seen);
+    return keys;
+}
+
+static struct keys pointerKeys(void)
+{
+    unsigned classCount;
+    Class *classes = objc_copyClassList(&classCount);
+    struct keys keys;
+    keys.count = classCount;
+    keys.hits = malloc(classCount * sizeof(void *));
+    keys.misses = malloc(classCount * sizeof(void *));
+    for (unsigned c = 0; c < classCount; c++) {
+        keys.hits[c] = (const void *)classes[c];
+        keys.misses[c] = (const char *)keys.hits[c] + 8;
+    }
+    free(classes);
+    return keys;
+}
+
+static void report(const char *name, unsigned count, uint64_t insertTicks,
+                   uint64_t hitTicks, uint64_t missTicks, size_t bytes)
+{
+    printf("%-12s %6u keys  insert %6.1f ns  hit %6.1f ns  "
+           "miss %6.1f ns  %5.1f bytes/entry\n", name, count,
+           insertTicks * ticksToNs / count,
+           hitTicks * ticksToNs / passes / count,
+           missTicks * ticksToNs / passes / count,
+           (double)bytes / count);
+}
+
+static size_t zoneBytes(malloc_zone_t *zone)
+{
+    malloc_statistics_t stats;
+    malloc_zone_statistics(zone, &stats);
+    return stats.size_in_use;
+}
+
+static void mapTable(const char *name, NXMapTablePrototype proto,
+                     struct keys *keys)
+{
+    malloc_zone_t *zone = malloc_create_zone(0, 0);
+    uint64_t start = mach_absolute_time();
+    NXMapTable *table = NXCreateMapTableFromZone(proto, 0, zone);
+    for (unsigned i = 0; i < keys->count; i++) {
+        NXMapInsert(table, keys->hits[i], keys->hits[i]);
+    }
+    uint64_t insertTicks = mach_absolute_time() - start;
+    size_t bytes = zoneBytes(zone);
+
+    shuffle(keys->hits, keys->count);
+    start = mach_absolute_time();
+    for (unsigned p = 0; p < passes; p++) {
+        for (unsigned i = 0; i < keys->count; i++) {
+            if (!NXMapGet(table, keys->hits[i])) abort();
+        }
+    }
+    uint64_t hitTicks = mach_absolute_time() - start;
+
+    start = mach_absolute_time();
+    for (unsigned p = 0; p < passes; p++) {
+        for (unsigned i = 0; i < keys->count; i++) {
+            if (NXMapGet(table, keys->misses[i])) abort();
+        }
+    }
+    uint64_t missTicks = mach_absolute_time() - start;
+
+    report(name, keys->count, insertTicks, hitTicks, missTicks, bytes);
+    NXFreeMapTable(table);
+    malloc_destroy_zone(zone);
+}
+
+static void hashTable(const char *name, NXHashTablePrototype proto,
+                      struct keys *keys)
+{
+    malloc_zone_t *zone = malloc_create_zone(0, 0);
+    uint64_t start = mach_absolute_time();
+    NXHashTable *table = NXCreateHashTableFromZone(proto, 0, NULL, zone);
+    for (unsigned i = 0; i < keys->count; i++) {
+        NXHashInsert(table, keys->hits[i]);
+    }
+    uint64_t insertTicks = mach_absolute_time() - start;
+    size_t bytes = zoneBytes(zone);
+
+    shuffle(keys->hits, keys->count);
+    start = mach_absolute_time();
+    for (unsigned p = 0; p < passes; p++) {
+        for (unsigned i = 0; i < keys->count; i++) {
+            if (!NXHashGet(table, keys->hits[i])) abort();
+        }
+    }
+    uint64_t hitTicks = mach_absolute_time() - start;
+
+    start = mach_absolute_time();
+    for (unsigned p = 0; p < passes; p++) {
+        for (unsigned i = 0; i < keys->count; i++) {
+            if (NXHashGet(table, keys->misses[i])) abort();
+        }
+    }
+    uint64_t missTicks = mach_absolute_time() - start;
+
+    report(name, keys->count, insertTicks, hitTicks, missTicks, bytes);
+    NXFreeHashTable(table);
+    malloc_destroy_zone(zone);
+}
+
+
+int main(int argc, char **argv)
+{
+    passes = argc > 1 ? (unsigned)atoi(argv[1]) : 100;
+    if (passes == 0) {
+        fprintf(stderr, "usage: maptable-lookup [lookup passes]\n");
+        return 1;
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    ticksToNs = (double)tb.numer / tb.denom;
+
+    if (!objc_getClass("NSString")) {
+        fprintf(stderr, "maptable-lookup: Foundation is not loaded\n");
+        return 1;
+    }
+
+    struct keys strings = stringKeys();
+    mapTable("map/string", NXStrValueMapPrototype, &strings);
+    hashTable("hash/string", NXStrPrototype, &strings);
+
+    struct keys pointers = pointerKeys();
+    mapTable("map/pointer", NXPtrValueMapPrototype, &pointers);
+    hashTable("hash/pointer", NXPtrPrototype, &pointers);
+    return 0;
+}
@@ -0,0 +1,86 @@
+#!/bin/sh
+#
+# method-search.sh
+# Time method list searches in synthetic classes with 10 to 2000 
+# methods.
+#
+# usage: method-search.sh [lookups per class]
+#
+# Generates classes whose methods are compiled into sorted method 
+# lists, as the compiler emits them, and times class_getInstanceMethod 
+# for random selectors of each class. class_getInstanceMethod searches 
+# the method lists on every call, whatever the method cache holds. 
+# "miss" rows look up selectors the class does not implement, which 
+# also search NSObject's lists.
+# Run it against the libobjc under test with DYLD_LIBRARY_PATH, and 
+# against the previous build for comparison.
+
+set -e
+
+LOOKUPS=${1:-1000000}
+TMP=$(mktemp -d /tmp/method-search.XXXXXX)
+SIZES="10 50 100 250 500 1000 2000"
+
+{
+    echo '#include <objc/runtime.h>'
+    echo '#include <objc/NSObject.h>'
+    echo '#include <mach/mach_time.h>'
+    echo '#include <stdio.h>'
+    echo '#include <stdlib.h>'
+    for n in $SIZES; do
+        echo "@interface C$n : NSObject @end"
+        echo "@implementation C$n"
+        awk -v n="$n" 'BEGIN { 
+            for (i = 0; i < n; i++) printf "- (void)m%d_%d { }\n", n, i 
+        }'
+        echo "@end"
+    done
+    cat <<'DRIVER'
+
+static void run(Class cls, unsigned n, unsigned lookups, bool miss)
+{
+    enum { SAMPLE = 1024 };
+    SEL sels[SAMPLE];
+    char name[64];
+    for (unsigned i = 0; i < SAMPLE; i++) {
+        unsigned m = arc4random_uniform(n);
+        snprintf(name, sizeof(name), miss ? "absent%u_%u" : "m%u_%u", n, m);
+        sels[i] = sel_registerName(name);
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    unsigned found = 0;
+    uint64_t start = mach_absolute_time();
+    for (unsigned i = 0; i < lookups; i++) {
+        if (class_getInstanceMethod(cls, sels[i % SAMPLE])) found++;
+    }
+    uint64_t ticks = mach_absolute_time() - start;
+    if (found != (miss ? 0 : lookups)) abort();
+
+    printf("%5u methods  %-4s  %7.1f ns/lookup\n", n, miss ? "miss" : "hit",
+           (double)ticks * tb.numer / tb.denom / lookups);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned lookups = (unsigned)atoi(argv[1]);
+    unsigned sizes[] = { SIZES };
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "C%u", sizes[i]);
+        Class cls = objc_getClass(name);
+        run(cls, sizes[i], lookups, false);
+        run(cls, sizes[i], lookups, true);
+    }
+    return 0;
+}
+DRIVER
+} > "$TMP/search.m"
+
+xcrun clang -O2 -fno-objc-arc -Wno-objc-missing-super-calls \
+    -DSIZES="$(echo $SIZES | tr ' ' ',')" \
+    "$TMP/search.m" -lobjc -o "$TMP/search"
+"$TMP/search" "$LOOKUPS"
+
+rm -rf "$TMP"
@@ -0,0 +1,118 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  msg-polymorphic
+  Cycles per objc_msgSend at a polymorphic call site.
+
+  usage: msg-polymorphic [sends per row]
+
+  build: xcrun clang -O2 -fno-objc-arc -arch x86_64 msg-polymorphic.m -lobjc
+
+  Build libobjc twice, with CACHE_MIX_HASH=0 and CACHE_MIX_HASH=1, and
+  run this against each with DYLD_LIBRARY_PATH.
+
+  One call site sends to receivers of classes classes in turn, cycling
+  through selectors selectors per class. The selectors are registered
+  back to back, so their addresses are close together, which is the
+  case where masking the selector pointer clusters cache buckets. Each
+  row is warmed up first, so every send hits the method cache. The
+  rows report cycles per send from the time stamp counter.
+  The cycle counts include the data cache misses of the bucket loads.
+  To count those misses separately, run it under Instruments' CPU
+  Counters template.
+*/
+
+#include <objc/runtime.h>
+#include <objc/message.h>
+#include <objc/NSObject.h>
+#include <x86intrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void work(id self __unused, SEL _cmd __unused) { }
+
+static unsigned classNumber;
+
+static void run(unsigned classes, unsigned selectors, unsigned sends)
+{
+    SEL *sels = malloc(selectors * sizeof(SEL));
+    for (unsigned s = 0; s < selectors; s++) {
+        char name[64];
+        snprintf(name, sizeof(name), "poly%u_%u", classNumber, s);
+        sels[s] = sel_registerName(name);
+    }
+
+    id *receivers = malloc(classes * sizeof(id));
+    for (unsigned c = 0; c < classes; c++) {
+        char name[64];
+        snprintf(name, sizeof(name), "Polymorphic%u", classNumber++);
+        Class cls = objc_allocateClassPair([NSObject class], name, 0);
+        for (unsigned s = 0; s < selectors; s++) {
+            class_addMethod(cls, sels[s], (IMP)work, "v@:");
+        }
+        objc_registerClassPair(cls);
+        receivers[c] = class_createInstance(cls, 0);
+    }
+
+    void (*send)(id, SEL) = (void (*)(id, SEL))objc_msgSend;
+    unsigned total = classes * selectors;
+
+    // Warm up: fill every cache with every selector.
+    for (unsigned i = 0; i < total; i++) {
+        send(receivers[i % classes], sels[(i / classes) % selectors]);
+    }
+
+    uint64_t start = __rdtsc();
+    for (unsigned i = 0; i < sends; i++) {
+        unsigned n = i % total;
+        send(receivers[n % classes], sels[n / classes]);
+    }
+    uint64_t cycles = __rdtsc() - start;
+
+    printf("%3u classes  %4u selectors  %6.2f cycles/send\n",
+           classes, selectors, (double)cycles / sends);
+
+    for (unsigned c = 0; c < classes; c++) object_dispose(receivers[c]);
+    free(receivers);
+    free(sels);
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned sends = argc > 1 ? (unsigned)atoi(argv[1]) : 50000000;
+    if (sends == 0) {
+        fprintf(stderr, "usage: msg-polymorphic [sends per row]\n");
+        return 1;
+    }
+
+    unsigned classCounts[] = { 1, 2, 4, 8, 16, 64 };
+    unsigned selectorCounts[] = { 4, 32, 256 };
+    for (unsigned c = 0; c < sizeof(classCounts)/sizeof(classCounts[0]); c++) {
+        for (unsigned s = 0;
+             s < sizeof(selectorCounts)/sizeof(selectorCounts[0]); s++)
+        {
+            run(classCounts[c], selectorCounts[s], sends);
+        }
+    }
+    return 0;
+}
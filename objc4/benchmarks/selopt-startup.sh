@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+# selopt-startup.sh
+# Time selector fixup for an image with 100,000 selector references, 
+# with and without a precomputed selector table from the selopt tool.
+#
+# usage: selopt-startup.sh [selector count]
+#
+# Builds two dylibs with the same selector references, one of them 
+# linked with the table, and reports how long dlopen() takes for each.
+# Run it against the libobjc under test with DYLD_LIBRARY_PATH.
+# OBJC_PRINT_PREOPTIMIZATION=YES confirms the table is adopted.
+
+set -e
+
+COUNT=${1:-100000}
+SRCROOT=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d /tmp/selopt-startup.XXXXXX)
+CC="xcrun -sdk macosx clang"
+CFLAGS="-Wall -O2 -arch x86_64 -mmacosx-version-min=10.9"
+
+clang++ -Wall -std=c++11 "$SRCROOT/selopt.cpp" -o "$TMP/selopt"
+
+# One selector reference per name, so every name needs a fixup.
+awk -v n="$COUNT" 'BEGIN { 
+    for (i = 0; i < n; i++) printf "selopt_bench_%d:with:\n", i 
+}' > "$TMP/names.txt"
+awk '{ printf "SEL s%d(void) { return @selector(%s); }\n", NR, $0 }' \
+    "$TMP/names.txt" > "$TMP/refs.m"
+"$TMP/selopt" -o "$TMP/table.c" "$TMP/names.txt"
+
+$CC $CFLAGS -dynamiclib -lobjc "$TMP/refs.m" \
+    -o "$TMP/libplain.dylib"
+$CC $CFLAGS -dynamiclib -lobjc "$TMP/refs.m" "$TMP/table.c" \
+    -o "$TMP/libselopt.dylib"
+
+cat > "$TMP/driver.c" <<'DRIVER'
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <mach/mach_time.h>
+
+int main(int argc, char **argv)
+{
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    uint64_t start = mach_absolute_time();
+    if (!dlopen(argv[1], RTLD_NOW)) {
+        fprintf(stderr, "%s\n", dlerror());
+        return 1;
+    }
+    uint64_t end = mach_absolute_time();
+    printf("%s: %.3f ms\n", argv[1], 
+           (double)(end - start) * tb.numer / tb.denom / 1e6);
+    return 0;
+}
+DRIVER
+$CC $CFLAGS -lobjc "$TMP/driver.c" -o "$TMP/driver"
+
+# Each run is a fresh process, so every dlopen() registers from scratch.
+for i in 1 2 3 4 5; do
+    "$TMP/driver" "$TMP/libplain.dylib"
+    "$TMP/driver" "$TMP/libselopt.dylib"
+done
+
+rm -rf "$TMP"
@@ -0,0 +1,178 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  sync-enter
+  objc_sync_enter/objc_sync_exit cost, uncontended and contended.
+
+  usage: sync-enter [max threads] [seconds per step]
+
+  build: xcrun clang -O2 -fno-objc-arc sync-enter.m -lobjc
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH.
+  With OBJC_DEBUG_SYNC_STATS=YES each row also prints the
+  _objc_sync_getStats() counters it added: cache hits, list searches,
+  and how each lock was acquired.
+
+  Rows:
+  uncontended  one thread locks one object; the per-thread fast cache
+  nested       one thread locks one object recursively, 4 deep;
+               each op is the whole nest
+  many-objects one thread cycles through 64 objects; the SyncCache
+  contended    every thread locks one shared object around a short
+               critical section
+*/
+
+#include <objc/runtime.h>
+#include <objc/objc-sync.h>
+#include <objc/NSObject.h>
+#include <mach/mach_time.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// From objc-internal.h, which the SDK does not ship.
+struct objc_sync_stats {
+    uint64_t fastCacheHits;
+    uint64_t threadCacheHits;
+    uint64_t listSearches;
+    uint64_t uncontendedAcquires;
+    uint64_t spinAcquires;
+    uint64_t blockingAcquires;
+};
+OBJC_EXPORT void _objc_sync_getStats(struct objc_sync_stats *stats);
+
+static volatile bool stop;
+static struct objc_sync_stats before;
+
+enum { OBJECT_COUNT = 64 };
+static id objects[OBJECT_COUNT];
+
+enum mode { UNCONTENDED, NESTED, MANY_OBJECTS, CONTENDED };
+
+struct worker {
+    pthread_t thread;
+    enum mode mode;
+    uint64_t ops;
+};
+
+static volatile uint64_t shared;
+
+static void *loop(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    id obj = objects[0];
+    uint64_t ops = 0;
+    while (!stop) {
+        switch (w->mode) {
+        case UNCONTENDED:
+            objc_sync_enter(obj);
+            objc_sync_exit(obj);
+            break;
+        case NESTED:
+            objc_sync_enter(obj);
+            objc_sync_enter(obj);
+            objc_sync_enter(obj);
+            objc_sync_enter(obj);
+            objc_sync_exit(obj);
+            objc_sync_exit(obj);
+            objc_sync_exit(obj);
+            objc_sync_exit(obj);
+            break;
+        case MANY_OBJECTS: {
+            id o = objects[ops % OBJECT_COUNT];
+            objc_sync_enter(o);
+            objc_sync_exit(o);
+            break;
+        }
+        case CONTENDED:
+            objc_sync_enter(obj);
+            for (int i = 0; i < 20; i++) shared++;
+            objc_sync_exit(obj);
+            break;
+        }
+        ops++;
+    }
+    w->ops = ops;
+    return NULL;
+}
+
+static void run(const char *name, enum mode mode,
+                unsigned threads, unsigned seconds)
+{
+    struct worker *workers = calloc(threads, sizeof(*workers));
+
+    _objc_sync_getStats(&before);
+    stop = false;
+    for (unsigned i = 0; i < threads; i++) {
+        workers[i].mode = mode;
+        pthread_create(&workers[i].thread, NULL, loop, &workers[i]);
+    }
+    sleep(seconds);
+    stop = true;
+
+    uint64_t ops = 0;
+    for (unsigned i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        ops += workers[i].ops;
+    }
+    free(workers);
+
+    printf("%-12s %3u threads  %9.2f M enter+exit/s  %7.1f ns each\n",
+           name, threads, ops / 1e6 / seconds,
+           seconds * 1e9 * threads / ops);
+
+    struct objc_sync_stats after;
+    _objc_sync_getStats(&after);
+    if (getenv("OBJC_DEBUG_SYNC_STATS")) {
+        printf("    fast %llu  cache %llu  search %llu  "
+               "free %llu  spin %llu  block %llu\n",
+               after.fastCacheHits - before.fastCacheHits,
+               after.threadCacheHits - before.threadCacheHits,
+               after.listSearches - before.listSearches,
+               after.uncontendedAcquires - before.uncontendedAcquires,
+               after.spinAcquires - before.spinAcquires,
+               after.blockingAcquires - before.blockingAcquires);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned maxThreads = argc > 1 ? (unsigned)atoi(argv[1]) : 64;
+    unsigned seconds = argc > 2 ? (unsigned)atoi(argv[2]) : 2;
+    if (maxThreads == 0  ||  seconds == 0) {
+        fprintf(stderr, "usage: sync-enter [max threads] "
+                "[seconds per step]\n");
+        return 1;
+    }
+
+    for (int i = 0; i < OBJECT_COUNT; i++) objects[i] = [NSObject new];
+
+    run("uncontended", UNCONTENDED, 1, seconds);
+    run("nested", NESTED, 1, seconds);
+    run("many-objects", MANY_OBJECTS, 1, seconds);
+    for (unsigned threads = 2; threads <= maxThreads; threads *= 2) {
+        run("contended", CONTENDED, threads, seconds);
+    }
+    return 0;
+}
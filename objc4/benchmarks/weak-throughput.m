@@ -0,0 +1,188 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  weak-throughput
+  objc_storeWeak and objc_loadWeakRetained throughput as threads are
+  added, and the cost of deallocating an object with many weak
+  references.
+
+  usage: weak-throughput [max threads] [seconds per step]
+
+  build: xcrun clang -O2 -fno-objc-arc weak-throughput.m -lobjc
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH.
+
+  Each thread repeatedly stores an object into a weak variable, loads
+  it back retained, and releases it. In the "private" rows every
+  thread uses its own object. In the "shared" rows all threads point
+  their own weak variables at one object, so they contend for that
+  object's side table. The last part deallocates objects with up to
+  100,000 weak referrers while another thread keeps storing weak
+  references, and reports the dealloc time and the worst storeWeak
+  latency seen meanwhile.
+*/
+
+#include <objc/runtime.h>
+#include <objc/NSObject.h>
+#include <mach/mach_time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// From objc-internal.h, which the SDK does not ship.
+OBJC_EXPORT id objc_storeWeak(id *location, id obj);
+OBJC_EXPORT id objc_loadWeakRetained(id *location);
+OBJC_EXPORT id objc_initWeak(id *location, id val);
+OBJC_EXPORT void objc_destroyWeak(id *location);
+OBJC_EXPORT void objc_release(id obj);
+
+static double ticksToNs;
+static volatile bool stop;
+
+static uint64_t now(void) { return mach_absolute_time(); }
+
+
+struct worker {
+    pthread_t thread;
+    id target;
+    uint64_t ops;
+};
+
+static void *storeLoadLoop(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    id weakVar = nil;
+    uint64_t ops = 0;
+    while (!stop) {
+        objc_storeWeak(&weakVar, w->target);
+        id obj = objc_loadWeakRetained(&weakVar);
+        objc_release(obj);
+        objc_storeWeak(&weakVar, nil);
+        ops++;
+    }
+    w->ops = ops;
+    return NULL;
+}
+
+static void throughput(unsigned threads, unsigned seconds, bool shared)
+{
+    struct worker *workers = calloc(threads, sizeof(*workers));
+    id sharedTarget = [NSObject new];
+
+    stop = false;
+    for (unsigned i = 0; i < threads; i++) {
+        workers[i].target = shared ? sharedTarget : [NSObject new];
+        pthread_create(&workers[i].thread, NULL, storeLoadLoop, &workers[i]);
+    }
+    sleep(seconds);
+    stop = true;
+
+    uint64_t ops = 0;
+    for (unsigned i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        ops += workers[i].ops;
+        if (!shared) [workers[i].target release];
+    }
+    [sharedTarget release];
+    free(workers);
+
+    printf("%-7s %3u threads  %8.2f M store+load/s  %8.2f M/s per thread\n",
+           shared ? "shared" : "private", threads,
+           ops / 1e6 / seconds, ops / 1e6 / seconds / threads);
+}
+
+
+static _Atomic uint64_t worstStoreNs;
+
+static void *storeLatencyLoop(void *arg __unused)
+{
+    id weakVar = nil;
+    id target = [NSObject new];
+    while (!stop) {
+        uint64_t start = now();
+        objc_storeWeak(&weakVar, target);
+        objc_storeWeak(&weakVar, nil);
+        uint64_t ns = (uint64_t)((now() - start) * ticksToNs);
+        if (ns > worstStoreNs) worstStoreNs = ns;
+    }
+    [target release];
+    return NULL;
+}
+
+static void deallocWithReferrers(unsigned count)
+{
+    id *vars = calloc(count, sizeof(id));
+    id obj = [NSObject new];
+    for (unsigned i = 0; i < count; i++) objc_initWeak(&vars[i], obj);
+
+    pthread_t thread;
+    stop = false;
+    worstStoreNs = 0;
+    pthread_create(&thread, NULL, storeLatencyLoop, NULL);
+    usleep(10000);
+
+    uint64_t start = now();
+    [obj release];
+    uint64_t ns = (uint64_t)((now() - start) * ticksToNs);
+
+    usleep(10000);
+    stop = true;
+    pthread_join(thread, NULL);
+
+    for (unsigned i = 0; i < count; i++) {
+        if (vars[i]) abort();  // dealloc must clear every referrer
+        objc_destroyWeak(&vars[i]);
+    }
+    free(vars);
+
+    printf("dealloc with %6u weak referrers  %10.1f us  "
+           "worst concurrent storeWeak %8.1f us\n",
+           count, ns / 1000.0, worstStoreNs / 1000.0);
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned maxThreads = argc > 1 ? (unsigned)atoi(argv[1]) : 64;
+    unsigned seconds = argc > 2 ? (unsigned)atoi(argv[2]) : 2;
+    if (maxThreads == 0  ||  seconds == 0) {
+        fprintf(stderr, "usage: weak-throughput [max threads] "
+                "[seconds per step]\n");
+        return 1;
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    ticksToNs = (double)tb.numer / tb.denom;
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        throughput(threads, seconds, false);
+    }
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        throughput(threads, seconds, true);
+    }
+    for (unsigned count = 100; count <= 100000; count *= 10) {
+        deallocWithReferrers(count);
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  zero-fill
+  alloc/init/release cost of large instances with and without
+  objc_setClassSkipsZeroFill().
+
+  usage: zero-fill [objects per row]
+
+  build: xcrun clang -O2 -fobjc-arc zero-fill.m -lobjc
+
+  Run it against the libobjc under test with DYLD_LIBRARY_PATH. The
+  classes must be compiled with ARC: the runtime leaves non-object
+  ivars unzeroed only in ARC classes.
+
+  For each instance size from 64 bytes to 64 KB there are two classes
+  with the same ivars, one object and a byte array filling the rest.
+  Their -init sets every ivar, as a class that opts out of zero-filling
+  must. Only the "skip" class opts out. Below 256 bytes both are
+  allocated the same way. Against a libobjc without
+  objc_setClassSkipsZeroFill() both columns use calloc().
+*/
+
+#include <objc/runtime.h>
+#include <objc/NSObject.h>
+#include <mach/mach_time.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZED_CLASS(name, size)                                         \
+    @interface name : NSObject {                                        \
+        id object;                                                      \
+        char bytes[size - 2*sizeof(void *)];                            \
+    }                                                                   \
+    @end                                                                \
+    @implementation name                                                \
+    - (instancetype)init {                                              \
+        if ((self = [super init])) {                                    \
+            object = nil;                                               \
+            memset(bytes, 0xab, sizeof(bytes));                         \
+        }                                                               \
+        return self;                                                    \
+    }                                                                   \
+    @end
+
+#define SIZE_CLASSES(size)                                              \
+    SIZED_CLASS(Fill##size, size)                                       \
+    SIZED_CLASS(Skip##size, size)
+
+SIZE_CLASSES(64)
+SIZE_CLASSES(256)
+SIZE_CLASSES(1024)
+SIZE_CLASSES(4096)
+SIZE_CLASSES(16384)
+SIZE_CLASSES(65536)
+
+static double ticksToNs;
+
+static double nsPerObject(Class cls, unsigned count)
+{
+    uint64_t start = mach_absolute_time();
+    for (unsigned i = 0; i < count; i++) {
+        id obj __unused = [[cls alloc] init];
+    }
+    return (mach_absolute_time() - start) * ticksToNs / count;
+}
+
+static void run(Class fill, Class skip, unsigned count)
+{
+    size_t size = class_getInstanceSize(fill);
+    // Warm up the malloc free lists for this size.
+    nsPerObject(fill, 100);
+    nsPerObject(skip, 100);
+
+    double fillNs = nsPerObject(fill, count);
+    double skipNs = nsPerObject(skip, count);
+    printf("%6zu bytes  zero-filled %9.1f ns  skipped %9.1f ns  "
+           "%5.2fx\n", size, fillNs, skipNs, fillNs / skipNs);
+}
+
+
+int main(int argc, char **argv)
+{
+    unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 200000;
+    if (count == 0) {
+        fprintf(stderr, "usage: zero-fill [objects per row]\n");
+        return 1;
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    ticksToNs = (double)tb.numer / tb.denom;
+
+    // From objc-internal.h, which the SDK does not ship. Looked up at
+    // run time so the previous libobjc can run this too.
+    void (*setSkipsZeroFill)(Class, BOOL) = (void (*)(Class, BOOL))
+        dlsym(RTLD_DEFAULT, "objc_setClassSkipsZeroFill");
+
+    Class pairs[][2] = {
+        { [Fill64 class],    [Skip64 class] },
+        { [Fill256 class],   [Skip256 class] },
+        { [Fill1024 class],  [Skip1024 class] },
+        { [Fill4096 class],  [Skip4096 class] },
+        { [Fill16384 class], [Skip16384 class] },
+        { [Fill65536 class], [Skip65536 class] },
+    };
+    unsigned rows = sizeof(pairs)/sizeof(pairs[0]);
+
+    if (!setSkipsZeroFill) {
+        printf("objc_setClassSkipsZeroFill() not found; "
+               "both columns zero-fill\n");
+    }
+    for (unsigned i = 0; i < rows; i++) {
+        if (setSkipsZeroFill) setSkipsZeroFill(pairs[i][1], YES);
+        // Large rows allocate whole pages each time; use fewer objects.
+        unsigned n = class_getInstanceSize(pairs[i][0]) > 4096
+            ? count / 16 : count;
+        run(pairs[i][0], pairs[i][1], n ? n : 1);
+    }
+    return 0;
+}
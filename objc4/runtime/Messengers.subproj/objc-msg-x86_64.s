@@ -22,6 +22,12 @@
  */
 
 #include <TargetConditionals.h>
+
+// Must match cache_hash() in objc-cache.mm.
+#ifndef CACHE_MIX_HASH
+#define CACHE_MIX_HASH 0
+#endif
+
 #if __x86_64__  &&  !TARGET_OS_SIMULATOR
 
 /********************************************************************
@@ -344,8 +350,16 @@ LExit$0:
 .else
 	movq	%a3, %r11		// r11 = _cmd
 .endif
-	andl	24(%r10), %r11d		// r11 = _cmd & class->cache.mask
-	shlq	$$4, %r11		// r11 = offset = (_cmd & mask)<<4
+#if CACHE_MIX_HASH
+	shrq	$$4, %r11		// r11 = _cmd >> 4
+.if $0 != STRET
+	xorq	%a2, %r11		// r11 = _cmd ^ (_cmd >> 4)
+.else
+	xorq	%a3, %r11		// r11 = _cmd ^ (_cmd >> 4)
+.endif
+#endif
+	andl	24(%r10), %r11d		// r11 = hash & class->cache.mask
+	shlq	$$4, %r11		// r11 = offset = (hash & mask)<<4
 	addq	16(%r10), %r11		// r11 = class->cache.buckets + offset
 
 .if $0 != STRET
@@ -144,8 +144,11 @@ struct SideTable {
     spinlock_t slock;
     RefcountMap refcnts;
     weak_table_t weak_table;
+    // Number of lock() calls that found slock already held.
+    // Written only while slock is held.
+    size_t contentionCount;
 
-    SideTable() {
+    SideTable() : contentionCount(0) {
         memset(&weak_table, 0, sizeof(weak_table));
     }
 
@@ -153,7 +156,12 @@ struct SideTable {
         _objc_fatal("Do not delete SideTable.");
     }
 
-    void lock() { slock.lock(); }
+    void lock() {
+        if (slowpath(!slock.tryLock())) {
+            slock.lock();
+            contentionCount++;
+        }
+    }
     void unlock() { slock.unlock(); }
     void forceReset() { slock.forceReset(); }
 
@@ -170,7 +178,14 @@ template<>
 void SideTable::lockTwo<DoHaveOld, DoHaveNew>
     (SideTable *lock1, SideTable *lock2)
 {
-    spinlock_t::lockTwo(&lock1->slock, &lock2->slock);
+    // Same order as spinlock_t::lockTwo, but counts contention.
+    if (lock1 < lock2) {
+        lock1->lock();
+        lock2->lock();
+    } else {
+        lock2->lock();
+        if (lock2 != lock1) lock1->lock();
+    }
 }
 
 template<>
@@ -209,24 +224,184 @@ void SideTable::unlockTwo<DontHaveOld, DoHaveNew>
 }
 
 
+// SideTableMap is StripedMap<SideTable> with a stripe count 
+// chosen at startup from the number of CPUs.
+// Each stripe is padded to its own cache lines. The stripes are 
+// allocated with mmap and not constructed: an all-zero SideTable is 
+// a valid empty one. Their pages are only faulted in when first 
+// touched. On systems that place pages on the NUMA node of the CPU 
+// that first touches them, each stripe then lands near its first user. 
+// Darwin has no API for explicit placement, so elsewhere the stripes 
+// get no NUMA locality.
+// Before init() the map is a single zero-filled static stripe, 
+// so early callers still find a valid empty table.
+class SideTableMap {
+
+    enum { CacheLineSize = 64 };
+
+#if TARGET_OS_EMBEDDED
+    enum { MinStripeCount = 8 };
+#else
+    enum { MinStripeCount = 64 };
+#endif
+    enum { MaxStripeCount = 4096 };
+
+    struct PaddedSideTable {
+        SideTable value alignas(CacheLineSize);
+    };
+
+    // Both are zero until init(), which selects earlyStripe.
+    PaddedSideTable *array;
+    unsigned int stripeMask;
+
+    static PaddedSideTable *earlyStripe() {
+        alignas(PaddedSideTable) static uint8_t 
+            buf[sizeof(PaddedSideTable)];
+        return reinterpret_cast<PaddedSideTable *>(buf);
+    }
+
+    PaddedSideTable *tables() {
+        if (fastpath(array)) return array;
+        return earlyStripe();
+    }
+
+    unsigned int indexForPointer(const void *p) const {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(p);
+        return ((addr >> 4) ^ (addr >> 9)) & stripeMask;
+    }
+
+    // Two stripes per CPU, rounded up to a power of two.
+    static unsigned int stripeCountForCPUs() {
+        long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+        if (ncpu < 1) ncpu = 1;
+        unsigned int count = MinStripeCount;
+        while (count < MaxStripeCount  &&  count < (unsigned long)ncpu * 2) {
+            count *= 2;
+        }
+        return count;
+    }
+
+ public:
+    // Runs once from _objc_init, before any other thread exists.
+    void init() {
+        unsigned int stripeCount = stripeCountForCPUs();
+        size_t bytes = round_page(stripeCount * sizeof(PaddedSideTable));
+        void *buf = mmap(nil, bytes, PROT_READ | PROT_WRITE, 
+                         MAP_ANON | MAP_PRIVATE, -1, 0);
+        if (buf == MAP_FAILED) {
+            _objc_fatal("could not allocate %u side tables", stripeCount);
+        }
+        PaddedSideTable *tables = (PaddedSideTable *)buf;
+        for (unsigned int i = 0; i < stripeCount; i++) {
+            // Records the lock's address only; does not touch the page.
+            lockdebug_remember_mutex(&tables[i].value.slock);
+        }
+        stripeMask = stripeCount - 1;
+
+        // Move anything stored before init into its new stripe. 
+        // Nothing else reads the map until array is set below.
+        SideTable& early = earlyStripe()->value;
+        for (auto& it : early.refcnts) {
+            const void *obj = (objc_object *)it.first;
+            tables[indexForPointer(obj)].value.refcnts[it.first] = it.second;
+        }
+        early.refcnts.clear();
+
+        weak_table_t& earlyWeak = early.weak_table;
+        if (earlyWeak.weak_entries) {
+            for (size_t i = 0; i <= earlyWeak.mask; i++) {
+                weak_entry_t *entry = &earlyWeak.weak_entries[i];
+                if (!entry->referent) continue;
+                const void *obj = (objc_object *)entry->referent;
+                weak_move_entry_no_lock
+                    (&tables[indexForPointer(obj)].value.weak_table, entry);
+            }
+            free(earlyWeak.weak_entries);
+            bzero(&earlyWeak, sizeof(earlyWeak));
+        }
+
+        array = tables;
+    }
+
+    unsigned int count() const { return stripeMask + 1; }
+
+    unsigned int indexOf(const void *p) const { return indexForPointer(p); }
+
+    SideTable& atIndex(unsigned int i) { return tables()[i].value; }
+
+    SideTable& operator[] (const void *p) { 
+        return tables()[indexForPointer(p)].value; 
+    }
+
+    void lockAll() {
+        for (unsigned int i = 0; i < count(); i++) {
+            atIndex(i).lock();
+        }
+    }
+
+    void unlockAll() {
+        for (unsigned int i = 0; i < count(); i++) {
+            atIndex(i).unlock();
+        }
+    }
+
+    void forceResetAll() {
+        for (unsigned int i = 0; i < count(); i++) {
+            atIndex(i).forceReset();
+        }
+    }
+
+    void defineLockOrder() {
+        for (unsigned int i = 1; i < count(); i++) {
+            lockdebug_lock_precedes_lock(&atIndex(i-1).slock, 
+                                         &atIndex(i).slock);
+        }
+    }
+
+    void precedeLock(const void *newlock) {
+        // assumes defineLockOrder is also called
+        lockdebug_lock_precedes_lock(&atIndex(count()-1).slock, 
+                                     newlock);
+    }
+
+    void succeedLock(const void *oldlock) {
+        // assumes defineLockOrder is also called
+        lockdebug_lock_precedes_lock(oldlock, &atIndex(0).slock);
+    }
+};
+
 // We cannot use a C++ static initializer to initialize SideTables because
-// libc calls us before our C++ initializers run. We also don't want a global 
-// pointer to this struct because of the extra indirection.
-// Do it the hard way.
-alignas(StripedMap<SideTable>) static uint8_t 
-    SideTableBuf[sizeof(StripedMap<SideTable>)];
+// libc calls us before our C++ initializers run. SideTableStorage and 
+// its early stripe are zero-filled statics, which are valid as is.
+// The stripes are allocated by SideTableInit() from _objc_init().
+static SideTableMap SideTableStorage;
 
-static void SideTableInit() {
-    new (SideTableBuf) StripedMap<SideTable>();
+static SideTableMap& SideTables() {
+    return SideTableStorage;
 }
 
-static StripedMap<SideTable>& SideTables() {
-    return *reinterpret_cast<StripedMap<SideTable>*>(SideTableBuf);
+// Nil out weak references to a deallocating object.
+// The table lock is dropped between batches so an object with 
+// many weak referrers does not stall other objects in its stripe. 
+// An unlock immediately followed by a lock would almost always 
+// retake the lock before a waiter runs, so yield in between.
+// table must be locked on entry and is locked on exit.
+static void weak_clear_batched(SideTable& table, id referent)
+{
+    while (! weak_clear_batch_no_lock(&table.weak_table, referent)) {
+        table.unlock();
+        thread_switch(MACH_PORT_NULL, SWITCH_OPTION_DEPRESS, 1);
+        table.lock();
+    }
 }
 
 // anonymous namespace
 };
 
+void SideTableInit() {
+    SideTables().init();
+}
+
 void SideTableLockAll() {
     SideTables().lockAll();
 }
@@ -632,8 +807,45 @@ objc_moveWeak(id *dst, id *src)
 BREAKPOINT_FUNCTION(void objc_autoreleaseNoPool(id obj));
 BREAKPOINT_FUNCTION(void objc_autoreleasePoolInvalid(const void *token));
 
+// Per-thread cache of retired autorelease pool pages.
+// Threads that repeatedly grow and shrink their pools reuse these 
+// instead of going back to malloc. The first 
+// AUTORELEASE_POOL_RESIDENT_PAGES cached pages stay resident; 
+// pages cached beyond that are madvise()d so the kernel may 
+// reclaim them until they are reused.
+#define AUTORELEASE_POOL_RESIDENT_PAGES 4
+#define AUTORELEASE_POOL_CACHED_PAGES 16
+
+struct AutoreleasePoolPageCache {
+    unsigned int count;
+    void *pages[AUTORELEASE_POOL_CACHED_PAGES];
+};
+
+void _destroyAutoreleasePoolPageCache(struct AutoreleasePoolPageCache *cache)
+{
+    if (!cache) return;
+    for (unsigned int i = 0; i < cache->count; i++) {
+        free(cache->pages[i]);
+    }
+    free(cache);
+}
+
 namespace {
 
+#if SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS
+// An autorelease pool slot holding an object pointer and the number 
+// of additional times the object was autoreleased in a row.
+// A slot with count 0 is bit-identical to a plain object pointer.
+struct AutoreleasePoolEntry {
+    uintptr_t ptr: 48;
+    uintptr_t count: 16;
+
+    static const uintptr_t maxCount = 65535;  // 2^16 - 1
+};
+static_assert(sizeof(AutoreleasePoolEntry) == sizeof(id), 
+              "AutoreleasePoolEntry must be the size of a pointer");
+#endif
+
 struct magic_t {
     static const uint32_t M0 = 0xA1A1A1A1;
 #   define M1 "AUTORELEASE!"
@@ -697,11 +909,41 @@ class AutoreleasePoolPage
 
     // SIZE-sizeof(*this) bytes of contents follow
 
+    static AutoreleasePoolPageCache *pageCache(bool create)
+    {
+        // Heap debuggers should see every page allocation.
+        if (DebugPoolAllocation) return nil;
+
+        _objc_pthread_data *data = _objc_fetch_pthread_data(create);
+        if (!data) return nil;
+        if (!data->poolPageCache  &&  create) {
+            data->poolPageCache = (AutoreleasePoolPageCache *)
+                calloc(1, sizeof(AutoreleasePoolPageCache));
+        }
+        return data->poolPageCache;
+    }
+
+    // Uses the cache only if this thread already has one. pop() creates 
+    // it when it frees pages, so threads that never free a page do not 
+    // get per-thread data for it.
     static void * operator new(size_t size) {
+        AutoreleasePoolPageCache *cache = pageCache(false);
+        if (cache  &&  cache->count > 0) {
+            return cache->pages[--cache->count];
+        }
         return malloc_zone_memalign(malloc_default_zone(), SIZE, SIZE);
     }
     static void operator delete(void * p) {
-        return free(p);
+        // Don't create the cache here. This may run during thread 
+        // exit after the thread's runtime data has been destroyed.
+        AutoreleasePoolPageCache *cache = pageCache(false);
+        if (!cache  ||  cache->count == AUTORELEASE_POOL_CACHED_PAGES) {
+            return free(p);
+        }
+        if (cache->count >= AUTORELEASE_POOL_RESIDENT_PAGES) {
+            madvise(p, SIZE, MADV_FREE);
+        }
+        cache->pages[cache->count++] = p;
     }
 
     inline void protect() {
@@ -804,12 +1046,45 @@ class AutoreleasePoolPage
     {
         assert(!full());
         unprotect();
-        id *ret = next;  // faster than `return next-1` because of aliasing
+        id *ret;
+
+#if SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS
+        if (!DisableAutoreleaseCoalescing  &&  
+            obj != POOL_BOUNDARY  &&  !empty()) 
+        {
+            // Repeated autorelease of the top object bumps its count.
+            AutoreleasePoolEntry *topEntry = (AutoreleasePoolEntry *)next - 1;
+            if (topEntry->ptr == (uintptr_t)obj  &&  
+                topEntry->count < AutoreleasePoolEntry::maxCount) 
+            {
+                topEntry->count++;
+                ret = (id *)topEntry;  // need to reset ret
+                goto done;
+            }
+        }
+#endif
+        ret = next;  // faster than `return next-1` because of aliasing
         *next++ = obj;
+#if SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS
+     done:
+#endif
         protect();
         return ret;
     }
 
+    // Number of releases owed by one pool slot, and the object to release.
+    static inline id entryObject(id entry, size_t *releaseCount)
+    {
+#if SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS
+        AutoreleasePoolEntry e = *(AutoreleasePoolEntry *)&entry;
+        *releaseCount = e.count + 1;
+        return (id)(uintptr_t)e.ptr;
+#else
+        *releaseCount = 1;
+        return entry;
+#endif
+    }
+
     void releaseAll() 
     {
         releaseUntil(begin());
@@ -819,7 +1094,7 @@ class AutoreleasePoolPage
     {
         // Not recursive: we don't want to blow out the stack 
         // if a thread accumulates a stupendous amount of garbage
-        
+
         while (this->next != stop) {
             // Restart from hotPage() every time, in case -release 
             // autoreleased more objects
@@ -832,12 +1107,14 @@ class AutoreleasePoolPage
             }
 
             page->unprotect();
-            id obj = *--page->next;
+            id entry = *--page->next;
             memset((void*)page->next, SCRIBBLE, sizeof(*page->next));
             page->protect();
 
+            size_t releases;
+            id obj = entryObject(entry, &releases);
             if (obj != POOL_BOUNDARY) {
-                objc_release(obj);
+                while (releases--) objc_release(obj);
             }
         }
 
@@ -882,7 +1159,7 @@ class AutoreleasePoolPage
         setHotPage((AutoreleasePoolPage *)p);
 
         if (AutoreleasePoolPage *page = coldPage()) {
-            if (!page->empty()) pop(page->begin());  // pop all of the pools
+            if (!page->empty()) pop(page->begin(), true);  // pop all of the pools
             if (DebugMissingPools || DebugPoolAllocation) {
                 // pop() killed the pages already
             } else {
@@ -1047,7 +1324,12 @@ public:
         assert(obj);
         assert(!obj->isTaggedPointer());
         id *dest __unused = autoreleaseFast(obj);
+#if SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS
+        assert(!dest  ||  dest == EMPTY_POOL_PLACEHOLDER  ||  
+               (id)(uintptr_t)((AutoreleasePoolEntry *)dest)->ptr == obj);
+#else
         assert(!dest  ||  dest == EMPTY_POOL_PLACEHOLDER  ||  *dest == obj);
+#endif
         return obj;
     }
 
@@ -1090,7 +1372,7 @@ public:
         objc_autoreleasePoolInvalid(token);
     }
     
-    static inline void pop(void *token) 
+    static inline void pop(void *token, bool threadExiting = false) 
     {
         AutoreleasePoolPage *page;
         id *stop;
@@ -1100,7 +1382,7 @@ public:
             if (hotPage()) {
                 // Pool was used. Pop its contents normally.
                 // Pool pages remain allocated for re-use as usual.
-                pop(coldPage()->begin());
+                pop(coldPage()->begin(), threadExiting);
             } else {
                 // Pool was never used. Clear the placeholder.
                 setHotPage(nil);
@@ -1139,6 +1421,10 @@ public:
             setHotPage(nil);
         } 
         else if (page->child) {
+            // Make room to cache the pages freed below. Not at thread 
+            // exit, where the thread's runtime data may be gone already.
+            if (!threadExiting) pageCache(true);
+
             // hysteresis: keep one empty child if page is more than half full
             if (page->lessThanHalfFull()) {
                 page->child->kill();
@@ -1166,9 +1452,17 @@ public:
         for (id *p = begin(); p < next; p++) {
             if (*p == POOL_BOUNDARY) {
                 _objc_inform("[%p]  ################  POOL %p", p, p);
+                continue;
+            }
+            size_t releases;
+            id obj = entryObject(*p, &releases);
+            if (releases > 1) {
+                _objc_inform("[%p]  %#16lx  %s  autorelease count %zu", 
+                             p, (unsigned long)obj, 
+                             object_getClassName(obj), releases);
             } else {
                 _objc_inform("[%p]  %#16lx  %s", 
-                             p, (unsigned long)*p, object_getClassName(*p));
+                             p, (unsigned long)obj, object_getClassName(obj));
             }
         }
     }
@@ -1180,11 +1474,20 @@ public:
 
         AutoreleasePoolPage *page;
         ptrdiff_t objects = 0;
+        unsigned int pages = 0;
         for (page = coldPage(); page; page = page->child) {
             objects += page->next - page->begin();
+            pages++;
         }
         _objc_inform("%llu releases pending.", (unsigned long long)objects);
 
+        AutoreleasePoolPageCache *cache = pageCache(false);
+        unsigned int cached = cache ? cache->count : 0;
+        unsigned int advised = cached > AUTORELEASE_POOL_RESIDENT_PAGES 
+            ? cached - AUTORELEASE_POOL_RESIDENT_PAGES : 0;
+        _objc_inform("%u pages in use, %u pages cached (%u madvised).", 
+                     pages, cached, advised);
+
         if (haveEmptyPoolPlaceholder()) {
             _objc_inform("[%p]  ................  PAGE (placeholder)", 
                          EMPTY_POOL_PLACEHOLDER);
@@ -1266,7 +1569,7 @@ objc_object::clearDeallocating_slow()
     SideTable& table = SideTables()[this];
     table.lock();
     if (isa.weakly_referenced) {
-        weak_clear_no_lock(&table.weak_table, (id)this);
+        weak_clear_batched(table, (id)this);
     }
     if (isa.has_sidetable_rc) {
         table.refcnts.erase(this);
@@ -1450,13 +1753,23 @@ objc_object::sidetable_retain()
     SideTable& table = SideTables()[this];
     
     table.lock();
+    sidetable_retain_nolock(table);
+    table.unlock();
+
+    return (id)this;
+}
+
+
+void
+objc_object::sidetable_retain_nolock(SideTable& table)
+{
+#if SUPPORT_NONPOINTER_ISA
+    assert(!isa.nonpointer);
+#endif
     size_t& refcntStorage = table.refcnts[this];
     if (! (refcntStorage & SIDE_TABLE_RC_PINNED)) {
         refcntStorage += SIDE_TABLE_RC_ONE;
     }
-    table.unlock();
-
-    return (id)this;
 }
 
 
@@ -1572,9 +1885,24 @@ objc_object::sidetable_release(bool performDealloc)
 #endif
     SideTable& table = SideTables()[this];
 
+    table.lock();
+    bool do_dealloc = sidetable_release_nolock(table);
+    table.unlock();
+    if (do_dealloc  &&  performDealloc) {
+        ((void(*)(objc_object *, SEL))objc_msgSend)(this, SEL_dealloc);
+    }
+    return do_dealloc;
+}
+
+
+bool
+objc_object::sidetable_release_nolock(SideTable& table)
+{
+#if SUPPORT_NONPOINTER_ISA
+    assert(!isa.nonpointer);
+#endif
     bool do_dealloc = false;
 
-    table.lock();
     RefcountMap::iterator it = table.refcnts.find(this);
     if (it == table.refcnts.end()) {
         do_dealloc = true;
@@ -1586,10 +1914,6 @@ objc_object::sidetable_release(bool performDealloc)
     } else if (! (it->second & SIDE_TABLE_RC_PINNED)) {
         it->second -= SIDE_TABLE_RC_ONE;
     }
-    table.unlock();
-    if (do_dealloc  &&  performDealloc) {
-        ((void(*)(objc_object *, SEL))objc_msgSend)(this, SEL_dealloc);
-    }
     return do_dealloc;
 }
 
@@ -1606,9 +1930,11 @@ objc_object::sidetable_clearDeallocating()
     RefcountMap::iterator it = table.refcnts.find(this);
     if (it != table.refcnts.end()) {
         if (it->second & SIDE_TABLE_WEAKLY_REFERENCED) {
-            weak_clear_no_lock(&table.weak_table, (id)this);
+            weak_clear_batched(table, (id)this);
+            // The lock may have been dropped. Look up the entry again.
+            it = table.refcnts.find(this);
         }
-        table.refcnts.erase(it);
+        if (it != table.refcnts.end()) table.refcnts.erase(it);
     }
     table.unlock();
 }
@@ -1651,6 +1977,137 @@ objc_autorelease(id obj)
 }
 
 
+/***********************************************************************
+* objc_retainBatch / objc_releaseBatch
+* Retain or release an array of objects, such as a collection's contents.
+* Objects with inline retain counts take the usual fast path. 
+* Objects whose whole retain count lives in a side table are sorted 
+* by stripe so each stripe is locked once per chunk of objects.
+* objc_releaseBatch() sends -dealloc only after every release is done.
+**********************************************************************/
+
+// Maximum number of side table objects handled per stripe sort.
+#define RR_BATCH_CHUNK 64
+
+struct rr_batch_entry_t {
+    unsigned int stripe;
+    objc_object *obj;
+
+    bool operator < (const rr_batch_entry_t& other) const {
+        return stripe < other.stripe;
+    }
+};
+
+// Objects whose -dealloc is deferred until the end of a release batch.
+class dealloc_list_t {
+    objc_object *inlineObjects[RR_BATCH_CHUNK];
+    objc_object **objects;
+    size_t count;
+    size_t capacity;
+
+ public:
+    dealloc_list_t() 
+        : objects(inlineObjects), count(0), capacity(RR_BATCH_CHUNK) { }
+
+    ~dealloc_list_t() {
+        if (objects != inlineObjects) free(objects);
+    }
+
+    void add(objc_object *obj) {
+        if (count == capacity) {
+            capacity *= 2;
+            if (objects == inlineObjects) {
+                objects = (objc_object **)malloc(capacity * sizeof(obj));
+                memcpy(objects, inlineObjects, count * sizeof(obj));
+            } else {
+                objects = (objc_object **)
+                    realloc(objects, capacity * sizeof(obj));
+            }
+        }
+        objects[count++] = obj;
+    }
+
+    void deallocAll() {
+        for (size_t i = 0; i < count; i++) {
+            ((void(*)(objc_object *, SEL))objc_msgSend)(objects[i], 
+                                                          SEL_dealloc);
+        }
+        count = 0;
+    }
+};
+
+// Retain or release side table objects, locking each stripe once.
+// Objects that should be deallocated are added to deallocs.
+static void
+sidetable_rrBatch(rr_batch_entry_t *entries, unsigned int count, 
+                  bool retain, dealloc_list_t *deallocs)
+{
+    std::sort(entries, entries + count);
+
+    unsigned int i = 0;
+    while (i < count) {
+        SideTable& table = SideTables().atIndex(entries[i].stripe);
+        table.lock();
+        do {
+            objc_object *obj = entries[i].obj;
+            if (retain) obj->sidetable_retain_nolock(table);
+            else if (obj->sidetable_release_nolock(table)) deallocs->add(obj);
+            i++;
+        } while (i < count  &&  entries[i].stripe == entries[i-1].stripe);
+        table.unlock();
+    }
+}
+
+static void
+objc_rrBatch(id *objs, size_t count, bool retain)
+{
+    rr_batch_entry_t entries[RR_BATCH_CHUNK];
+    unsigned int entryCount = 0;
+    dealloc_list_t deallocs;
+
+    for (size_t i = 0; i < count; i++) {
+        id obj = objs[i];
+        if (!obj  ||  obj->isTaggedPointer()) continue;
+
+        if (slowpath(obj->ISA()->hasCustomRR())) {
+            // The override decides when to deallocate. Don't defer it.
+            if (retain) obj->retain();
+            else obj->release();
+        }
+        else if (obj->hasNonpointerIsa()) {
+            if (retain) obj->rootRetain();
+            else if (obj->rootReleaseShouldDealloc()) deallocs.add(obj);
+        }
+        else {
+            entries[entryCount].stripe = SideTables().indexOf(obj);
+            entries[entryCount].obj = obj;
+            if (++entryCount == RR_BATCH_CHUNK) {
+                sidetable_rrBatch(entries, entryCount, retain, &deallocs);
+                entryCount = 0;
+            }
+        }
+    }
+
+    if (entryCount) sidetable_rrBatch(entries, entryCount, retain, &deallocs);
+
+    deallocs.deallocAll();
+}
+
+
+void
+objc_retainBatch(id *objs, size_t count)
+{
+    objc_rrBatch(objs, count, true);
+}
+
+
+void
+objc_releaseBatch(id *objs, size_t count)
+{
+    objc_rrBatch(objs, count, false);
+}
+
+
 // OBJC2
 #else
 // not OBJC2
@@ -1660,8 +2117,189 @@ id objc_retain(id obj) { return [obj retain]; }
 void objc_release(id obj) { [obj release]; }
 id objc_autorelease(id obj) { return [obj autorelease]; }
 
+void objc_retainBatch(id *objs, size_t count) 
+{
+    for (size_t i = 0; i < count; i++) [objs[i] retain];
+}
+
+void objc_releaseBatch(id *objs, size_t count) 
+{
+    for (size_t i = 0; i < count; i++) [objs[i] release];
+}
+
+
+#endif
+
+
+/***********************************************************************
+* Deferred deallocation
+* A thread opts in with objc_setThreadDefersDealloc() and a class 
+* hierarchy with objc_setClassDefersDealloc(). The object's -dealloc 
+* methods still run on the releasing thread, and so does clearing its 
+* weak references: once -dealloc returns, weak loads of the object 
+* see nil, exactly as they do without deferral. The rest of its 
+* teardown (C++ destructors and ARC ivar cleanup, associated object 
+* removal, and free()) is pushed onto a lock-free queue and run on a 
+* background dispatch queue. Releasing the last reference to a large 
+* object graph then costs the releasing thread one push for the root 
+* of the graph.
+* Objects that take the fast free() path in rootDealloc() are freed 
+* immediately; they have nothing expensive to tear down.
+*
+* The queue is a ring of DEFERRED_DEALLOC_MAX object pointers, 
+* allocated on first use. The dead object's own storage cannot hold 
+* the link: every word past the isa may be an ivar that its C++ 
+* destructor still reads. Pushers reserve a slot with an atomic 
+* increment and then fill it; the drain spins briefly on a reserved 
+* slot that is not filled yet.
+* If DEFERRED_DEALLOC_MAX objects are already waiting, the releasing 
+* thread tears the object down itself.
+**********************************************************************/
+
+// Power of 2, so the uint32_t slot counters wrap cleanly.
+#define DEFERRED_DEALLOC_MAX 65536
+// Objects torn down per autorelease pool while draining.
+#define DEFERRED_DEALLOC_BATCH 1024
+
+// Values of _objc_pthread_data.deferDeallocMode
+enum {
+    DeferDeallocIfClassDefers = 0, 
+    DeferDeallocAlways, 
+    DeferDeallocNever   // used while draining the queue
+};
+
+// Set once anything opts in, so other processes pay one load per dispose.
+static bool DeferredDeallocUsed;
+static id *DeferredDeallocRing;
+static uint32_t DeferredDeallocTail;  // next slot to reserve; pushers
+static uint32_t DeferredDeallocHead;  // next slot to drain; drain only
+// Objects pushed and not yet torn down. Includes reserved slots.
+static volatile int32_t DeferredDeallocCount;
+static dispatch_queue_t DeferredDeallocQueue;
+
+
+static void deferred_dealloc_init(void)
+{
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        // calloc() of this size maps fresh zero-filled pages.
+        DeferredDeallocRing = (id *)calloc(DEFERRED_DEALLOC_MAX, sizeof(id));
+        dispatch_queue_attr_t attr = 
+            dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, 
+                                                    QOS_CLASS_UTILITY, 0);
+        DeferredDeallocQueue = 
+            dispatch_queue_create("com.apple.objc.deferred-dealloc", attr);
+    });
+}
+
+
+// Runs until the queue is empty. 
+// The push that finds the queue empty schedules the next drain.
+static void deferred_dealloc_drain(void *ctxt __unused)
+{
+    _objc_pthread_data *data = _objc_fetch_pthread_data(true);
+    int oldMode = data->deferDeallocMode;
+    data->deferDeallocMode = DeferDeallocNever;
+
+    void *pool = objc_autoreleasePoolPush();
+    unsigned batch = 0;
+    do {
+        id *slot = &DeferredDeallocRing[DeferredDeallocHead++ % DEFERRED_DEALLOC_MAX];
+        id obj;
+        while (!(obj = __atomic_load_n(slot, __ATOMIC_ACQUIRE))) {
+            // Reserved but not filled yet. The pusher is one store away.
+            thread_switch(MACH_PORT_NULL, SWITCH_OPTION_DEPRESS, 1);
+        }
+        __atomic_store_n(slot, nil, __ATOMIC_RELAXED);
+
+        object_dispose(obj);
+
+        if (++batch == DEFERRED_DEALLOC_BATCH) {
+            objc_autoreleasePoolPop(pool);
+            pool = objc_autoreleasePoolPush();
+            batch = 0;
+        }
+    } while (OSAtomicDecrement32Barrier(&DeferredDeallocCount) != 0);
+    objc_autoreleasePoolPop(pool);
+
+    data->deferDeallocMode = oldMode;
+}
+
+
+static bool deferred_dealloc_push(id obj)
+{
+    int32_t count;
+    do {
+        count = DeferredDeallocCount;
+        if (count >= DEFERRED_DEALLOC_MAX) {
+            // Back-pressure: the drain is not keeping up.
+            return false;
+        }
+    } while (!OSAtomicCompareAndSwap32Barrier(count, count + 1, 
+                                              &DeferredDeallocCount));
+
+    deferred_dealloc_init();
+
+    // At most DEFERRED_DEALLOC_MAX objects are counted, 
+    // so the drain has already emptied this slot.
+    uint32_t slot = 
+        __atomic_fetch_add(&DeferredDeallocTail, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&DeferredDeallocRing[slot % DEFERRED_DEALLOC_MAX], 
+                     obj, __ATOMIC_RELEASE);
+
+    // The first push onto an empty queue schedules a drain.
+    if (count == 0) {
+        dispatch_async_f(DeferredDeallocQueue, nil, deferred_dealloc_drain);
+    }
+
+    return true;
+}
 
+
+static bool deferred_dealloc_wanted(id obj)
+{
+    _objc_pthread_data *data = _objc_fetch_pthread_data(false);
+    int mode = data ? data->deferDeallocMode : DeferDeallocIfClassDefers;
+    if (mode == DeferDeallocAlways) return true;
+    if (mode == DeferDeallocNever) return false;
+#if __OBJC2__
+    return obj->ISA()->defersDealloc();
+#else
+    return false;
 #endif
+}
+
+
+// Called by rootDealloc() for objects that need more than free().
+void 
+_objc_disposeOrDefer(id obj)
+{
+    if (slowpath(DeferredDeallocUsed)  &&  deferred_dealloc_wanted(obj)) {
+        // Clear weak references before -dealloc's caller returns. 
+        // objc_destructInstance() repeats this later and finds nothing.
+        obj->clearDeallocating();
+        if (deferred_dealloc_push(obj)) return;
+    }
+    object_dispose(obj);
+}
+
+
+void 
+_objc_enableDeferredDealloc(void)
+{
+    DeferredDeallocUsed = true;
+}
+
+
+void 
+objc_setThreadDefersDealloc(BOOL defer)
+{
+    _objc_pthread_data *data = _objc_fetch_pthread_data(defer);
+    if (!data) return;
+    if (defer) _objc_enableDeferredDealloc();
+    data->deferDeallocMode = 
+        defer ? DeferDeallocAlways : DeferDeallocIfClassDefers;
+}
 
 
 /***********************************************************************
@@ -1978,7 +2616,32 @@ objc_objectptr_t objc_unretainedPointer(id object) { return object; }
 void arr_init(void) 
 {
     AutoreleasePoolPage::init();
-    SideTableInit();
+}
+
+
+/***********************************************************************
+* _objc_sideTablePrint
+* Log the lock contention count of every SideTable stripe.
+* Counts are read without locks and may be slightly stale.
+**********************************************************************/
+void 
+_objc_sideTablePrint(void)
+{
+    SideTableMap& tables = SideTables();
+    size_t total = 0;
+
+    _objc_inform("##############");
+    _objc_inform("SIDE TABLES: %u stripes", tables.count());
+    for (unsigned int i = 0; i < tables.count(); i++) {
+        size_t count = tables.atIndex(i).contentionCount;
+        total += count;
+        if (count) {
+            _objc_inform("[%p]  stripe %4u: %zu contended locks", 
+                         &tables.atIndex(i), i, count);
+        }
+    }
+    _objc_inform("SIDE TABLES: %zu contended locks total", total);
+    _objc_inform("##############");
 }
 
 
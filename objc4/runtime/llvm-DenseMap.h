@@ -189,6 +189,9 @@ public:
 
   // Clear if empty.
   // Shrink if at least 15/16 empty and larger than MIN_COMPACT.
+  // Erase calls this, so erase invalidates iterators only when 
+  // the map becomes empty or is shrunk. Tombstones are rehashed 
+  // away on insert, which may invalidate iterators anyway.
   void compact() {
     if (getNumEntries() == 0) {
       shrink_and_clear();
@@ -200,6 +203,31 @@ public:
     }
   }
 
+  // Remove all tombstones without reallocating the buckets.
+  // Live entries move to a scratch array and are reinserted.
+  // The scratch array is smaller than the table because 
+  // this only runs when tombstones outnumber entries.
+  void rehashInPlace() {
+    BucketT *Tmp = static_cast<BucketT *>
+      (operator new(sizeof(BucketT) * getNumEntries()));
+    BucketT *TmpEnd = Tmp;
+
+    const KeyT EmptyKey = getEmptyKey();
+    const KeyT TombstoneKey = getTombstoneKey();
+    for (BucketT *B = getBuckets(), *E = getBucketsEnd(); B != E; ++B) {
+      if (!KeyInfoT::isEqual(B->first, EmptyKey) &&
+          !KeyInfoT::isEqual(B->first, TombstoneKey)) {
+        new (&TmpEnd->first) KeyT(llvm_move(B->first));
+        new (&TmpEnd->second) ValueT(llvm_move(B->second));
+        B->second.~ValueT();
+        ++TmpEnd;
+      }
+    }
+
+    this->moveFromOldBuckets(Tmp, TmpEnd);
+    operator delete(Tmp);
+  }
+
   bool erase(const KeyT &Val) {
     BucketT *TheBucket;
     if (!LookupBucketFor(Val, TheBucket))
@@ -459,6 +487,13 @@ private:
       this->grow(NumBuckets);
       LookupBucketFor(Key, TheBucket);
     }
+    else if (getNumTombstones() > getNumEntries()  &&  
+             getNumTombstones() >= NumBuckets/4) {
+      // Every miss probes through the tombstones. 
+      // Clear them out before they reach the 1/8 limit above.
+      rehashInPlace();
+      LookupBucketFor(Key, TheBucket);
+    }
     assert(TheBucket);
 
     // Only update the state after we've grown our bucket space appropriately
@@ -53,13 +53,31 @@ static INLINE unsigned xorHash(unsigned hash) {
     return ((xored * 65521) + hash);
 }
 
+static unsigned _mapPtrHash(NXMapTable *table, const void *key);
+static unsigned _mapStrHash(NXMapTable *table, const void *key);
+static int _mapPtrIsEqual(NXMapTable *table, const void *key1, const void *key2);
+static int _mapStrIsEqual(NXMapTable *table, const void *key1, const void *key2);
+
+/* The runtime's own tables use NXPtrValueMapPrototype and 
+ * NXStrValueMapPrototype. Call their functions directly so they 
+ * can be inlined into the probe loops; other prototypes go through 
+ * the function pointers. The table layout is unchanged because 
+ * debuggers read gdb_objc_realized_classes directly. */
 static INLINE unsigned bucketOf(NXMapTable *table, const void *key) {
-    unsigned	hash = (table->prototype->hash)(table, key);
+    unsigned	hash;
+    auto	hashProc = table->prototype->hash;
+    if (hashProc == _mapStrHash) hash = _mapStrHash(table, key);
+    else if (hashProc == _mapPtrHash) hash = _mapPtrHash(table, key);
+    else hash = hashProc(table, key);
     return hash & table->nbBucketsMinusOne;
 }
 
 static INLINE int isEqual(NXMapTable *table, const void *key1, const void *key2) {
-    return (key1 == key2) ? 1 : (table->prototype->isEqual)(table, key1, key2);
+    if (key1 == key2) return 1;
+    auto	isEqualProc = table->prototype->isEqual;
+    if (isEqualProc == _mapPtrIsEqual) return 0;
+    if (isEqualProc == _mapStrIsEqual) return _mapStrIsEqual(table, key1, key2);
+    return isEqualProc(table, key1, key2);
 }
 
 static INLINE unsigned nextIndex(NXMapTable *table, unsigned index) {
@@ -379,19 +397,15 @@ static unsigned _mapPtrHash(NXMapTable *table, const void *key) {
 }
     
 static unsigned _mapStrHash(NXMapTable *table, const void *key) {
-    unsigned		hash = 0;
+    /* FNV-1a. Selector and class names share long prefixes and 
+     * suffixes, which made the old byte-lane XOR collide often and 
+     * left long probe runs full of strcmp calls. */
+    unsigned		hash = 2166136261u;
     unsigned char	*s = (unsigned char *)key;
     /* unsigned to avoid a sign-extend */
-    /* unroll the loop */
-    if (s) for (; ; ) { 
-	if (*s == '\0') break;
+    if (s) while (*s) {
 	hash ^= *s++;
-	if (*s == '\0') break;
-	hash ^= *s++ << 8;
-	if (*s == '\0') break;
-	hash ^= *s++ << 16;
-	if (*s == '\0') break;
-	hash ^= *s++ << 24;
+	hash *= 16777619u;
     }
     return xorHash(hash);
 }
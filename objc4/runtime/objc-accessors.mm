@@ -40,7 +40,7 @@
 @end
 
 StripedMap<spinlock_t> PropertyLocks;
-StripedMap<spinlock_t> StructLocks;
+StripedMap<seqlock_t> StructLocks;
 StripedMap<spinlock_t> CppObjectLocks;
 
 #define MUTABLE_COPY 2
@@ -55,9 +55,16 @@ id objc_getProperty(id self, SEL _cmd, ptrdiff_t offset, BOOL atomic) {
     if (!atomic) return *slot;
         
     // Atomic retain release world
+    // nil and tagged pointers need no retain, and a pointer-sized load 
+    // is never torn, so they are returned without the lock. 
+    // Other values must be retained while the lock is held, because 
+    // the setter releases the old value as soon as it unlocks.
+    id value = *(id volatile *)slot;
+    if (!value  ||  value->isTaggedPointer()) return value;
+
     spinlock_t& slotlock = PropertyLocks[slot];
     slotlock.lock();
-    id value = objc_retain(*slot);
+    value = objc_retain(*slot);
     slotlock.unlock();
     
     // for performance, we (safely) issue the autorelease OUTSIDE of the spinlock.
@@ -129,23 +136,62 @@ void objc_setProperty_nonatomic_copy(id self, SEL _cmd, id newValue, ptrdiff_t o
 }
 
 
+// Returns true if p is in the calling thread's stack, 
+// somewhere in the frames of our callers.
+static inline bool isInCallerStack(const void *p)
+{
+    uintptr_t addr = (uintptr_t)p;
+    return addr > (uintptr_t)__builtin_frame_address(0)  &&  
+        addr < (uintptr_t)pthread_get_stackaddr_np(pthread_self());
+}
+
+// Optimistic reads of src give up and lock after this many retries, 
+// in case the writer was descheduled while holding the lock.
+#define COPY_STRUCT_READ_TRIES 8
+
 // This entry point was designed wrong.  When used as a getter, src needs to be locked so that
 // if simultaneously used for a setter then there would be contention on src.
 // So we need two locks - one of which will be contended.
+// StructLocks are seqlocks to avoid most of that contention. dest is 
+// written under its lock. src is copied without locking and copied 
+// again if a writer was active. When dest is in the caller's stack 
+// (the getter case) no other thread can see it, so nothing is locked.
 void objc_copyStruct(void *dest, const void *src, ptrdiff_t size, BOOL atomic, BOOL hasStrong __unused) {
-    spinlock_t *srcLock = nil;
-    spinlock_t *dstLock = nil;
-    if (atomic) {
-        srcLock = &StructLocks[src];
+    if (!atomic) {
+        memmove(dest, src, size);
+        return;
+    }
+
+    seqlock_t *srcLock = &StructLocks[src];
+    seqlock_t *dstLock = nil;
+    if (!isInCallerStack(dest)) {
         dstLock = &StructLocks[dest];
-        spinlock_t::lockTwo(srcLock, dstLock);
+        dstLock->lock();
     }
 
-    memmove(dest, src, size);
+    if (dstLock == srcLock) {
+        // We hold src's lock as a writer, so src can't change.
+        memmove(dest, src, size);
+        dstLock->unlock();
+        return;
+    }
 
-    if (atomic) {
-        spinlock_t::unlockTwo(srcLock, dstLock);
+    for (unsigned tries = 0; tries < COPY_STRUCT_READ_TRIES; tries++) {
+        uint32_t seq = srcLock->readBegin();
+        if (seq & 1) continue;
+        memmove(dest, src, size);
+        if (!srcLock->readRetry(seq)) {
+            if (dstLock) dstLock->unlock();
+            return;
+        }
     }
+
+    // Contended. Copy with both locks held.
+    if (dstLock) dstLock->unlock();
+    else dstLock = srcLock;
+    seqlock_t::lockTwo(srcLock, dstLock);
+    memmove(dest, src, size);
+    seqlock_t::unlockTwo(srcLock, dstLock);
 }
 
 void objc_copyCppObjectAtomic(void *dest, const void *src, void (*copyHelper) (void *dest, const void *source)) {
@@ -80,12 +80,18 @@ typedef enum {
 // default alignment when running with small pages, but it also means 
 // the trampoline code MUST NOT look for its data by masking with PAGE_MAX_MASK.
 
+// Page pairs are carved in order from regions of reserved address space, 
+// so the page pair containing a trampoline is found from the 
+// trampoline's address. Each page pair has a number: its region's 
+// index * TRAMPOLINE_REGION_PAIRS + its position in the region.
+
+#define TRAMPOLINE_REGION_PAIRS 1024
+
 struct TrampolineBlockPagePair 
 {
-    TrampolineBlockPagePair *nextPagePair; // linked list of all pages
-    TrampolineBlockPagePair *nextAvailablePage; // linked list of pages with available slots
-    
     uintptr_t nextAvailable; // index of next available slot, endIndex() if no more available
+    uintptr_t argumentMode;  // ArgumentMode of this page pair's trampolines
+    uintptr_t number;        // page pair number
     
     // Payload data: block pointers and free list.
     // Bytes parallel with trampoline header code are the fields above or unused
@@ -121,6 +127,14 @@ struct TrampolineBlockPagePair
         return (uintptr_t)PAGE_MAX_SIZE / slotSize();
     }
 
+    static uintptr_t pairSize() {
+        return (uintptr_t)PAGE_MAX_SIZE * 2;
+    }
+
+    static uintptr_t regionSize() {
+        return TRAMPOLINE_REGION_PAIRS * pairSize();
+    }
+
     static bool validIndex(uintptr_t index) {
         return (index >= startIndex() && index < endIndex());
     }
@@ -177,8 +191,17 @@ struct TrampolineBlockPagePair
 
 };
 
+// start address of each region of page pairs
+static uintptr_t *trampolineRegions;
+static size_t trampolineRegionCount;
+// page pairs allocated from all regions
+static size_t trampolinePairCount;
+
 // two sets of trampoline pages; one for stack returns and one for register returns
-static TrampolineBlockPagePair *headPagePairs[ArgumentModeCount];
+// Bitmaps of page pairs with available slots, by page pair number.
+static uintptr_t *availablePagePairs[ArgumentModeCount];
+// Lowest word of availablePagePairs that may have a bit set.
+static size_t availablePagePairsHint[ArgumentModeCount];
 
 #pragma mark Utility Functions
 
@@ -207,87 +230,111 @@ static inline void _assert_locked() {
 }
 
 #pragma mark Trampoline Management Functions
+static bool _allocateTrampolineRegion() 
+{
+    _assert_locked();
+
+    vm_address_t regionAddress;
+    kern_return_t result = 
+        vm_allocate(mach_task_self(), &regionAddress, 
+                    TrampolineBlockPagePair::regionSize(), 
+                    VM_FLAGS_ANYWHERE | VM_MAKE_TAG(VM_MEMORY_FOUNDATION));
+    if (result != KERN_SUCCESS) {
+        mach_error("vm_allocate failed", result);
+        return false;
+    }
+
+    size_t count = trampolineRegionCount + 1;
+    trampolineRegions = (uintptr_t *)
+        realloc(trampolineRegions, count * sizeof(uintptr_t));
+    trampolineRegions[count-1] = regionAddress;
+
+    size_t oldWords = trampolineRegionCount * TRAMPOLINE_REGION_PAIRS / WORD_BITS;
+    size_t newWords = count * TRAMPOLINE_REGION_PAIRS / WORD_BITS;
+    for (int arg = 0; arg < ArgumentModeCount; arg++) {
+        availablePagePairs[arg] = (uintptr_t *)
+            realloc(availablePagePairs[arg], newWords * sizeof(uintptr_t));
+        bzero(availablePagePairs[arg] + oldWords, 
+              (newWords - oldWords) * sizeof(uintptr_t));
+    }
+
+    trampolineRegionCount = count;
+    return true;
+}
+
+static TrampolineBlockPagePair *_pagePairForNumber(size_t number) 
+{
+    uintptr_t region = trampolineRegions[number / TRAMPOLINE_REGION_PAIRS];
+    uintptr_t offset = (number % TRAMPOLINE_REGION_PAIRS) * 
+        TrampolineBlockPagePair::pairSize();
+    return (TrampolineBlockPagePair *)(region + offset);
+}
+
+static void _setPagePairAvailable(TrampolineBlockPagePair *pagePair, 
+                                  bool available) 
+{
+    _assert_locked();
+
+    int arg = (int)pagePair->argumentMode;
+    size_t word = pagePair->number / WORD_BITS;
+    uintptr_t bit = 1UL << (pagePair->number % WORD_BITS);
+    if (available) {
+        availablePagePairs[arg][word] |= bit;
+        if (word < availablePagePairsHint[arg]) {
+            availablePagePairsHint[arg] = word;
+        }
+    } else {
+        availablePagePairs[arg][word] &= ~bit;
+    }
+}
+
 static TrampolineBlockPagePair *_allocateTrampolinesAndData(ArgumentMode aMode) 
 {
     _assert_locked();
 
-    vm_address_t dataAddress;
-    
     TrampolineBlockPagePair::check();
 
-    TrampolineBlockPagePair *headPagePair = headPagePairs[aMode];
-    
-    if (headPagePair) {
-        assert(headPagePair->nextAvailablePage == nil);
+    size_t number = trampolinePairCount;
+    if (number / TRAMPOLINE_REGION_PAIRS == trampolineRegionCount) {
+        if (!_allocateTrampolineRegion()) return nil;
     }
-    
-    kern_return_t result;
-    for (int i = 0; i < 5; i++) {
-         result = vm_allocate(mach_task_self(), &dataAddress, 
-                              PAGE_MAX_SIZE * 2,
-                              TRUE | VM_MAKE_TAG(VM_MEMORY_FOUNDATION));
-        if (result != KERN_SUCCESS) {
-            mach_error("vm_allocate failed", result);
-            return nil;
-        }
 
-        vm_address_t codeAddress = dataAddress + PAGE_MAX_SIZE;
-        result = vm_deallocate(mach_task_self(), codeAddress, PAGE_MAX_SIZE);
-        if (result != KERN_SUCCESS) {
-            mach_error("vm_deallocate failed", result);
-            return nil;
-        }
-        
-        uintptr_t codePage;
-        switch(aMode) {
-            case ReturnValueInRegisterArgumentMode:
-                codePage = a1a2_tramphead();
-                break;
+    // The data page is already allocated as part of the region.
+    // Map the trampoline code over the page after it.
+    TrampolineBlockPagePair *pagePair = _pagePairForNumber(number);
+    vm_address_t codeAddress = (vm_address_t)pagePair + PAGE_MAX_SIZE;
+
+    uintptr_t codePage;
+    switch(aMode) {
+        case ReturnValueInRegisterArgumentMode:
+            codePage = a1a2_tramphead();
+            break;
 #if SUPPORT_STRET
-            case ReturnValueOnStackArgumentMode:
-                codePage = a2a3_tramphead();
-                break;
+        case ReturnValueOnStackArgumentMode:
+            codePage = a2a3_tramphead();
+            break;
 #endif
-            default:
-                _objc_fatal("unknown return mode %d", (int)aMode);
-                break;
-        }
-        vm_prot_t currentProtection, maxProtection;
-        result = vm_remap(mach_task_self(), &codeAddress, PAGE_MAX_SIZE, 
-                          0, FALSE, mach_task_self(), codePage, TRUE, 
-                          &currentProtection, &maxProtection, VM_INHERIT_SHARE);
-        if (result != KERN_SUCCESS) {
-            result = vm_deallocate(mach_task_self(), 
-                                   dataAddress, PAGE_MAX_SIZE);
-            if (result != KERN_SUCCESS) {
-                mach_error("vm_deallocate for retry failed.", result);
-                return nil;
-            } 
-        } else {
+        default:
+            _objc_fatal("unknown return mode %d", (int)aMode);
             break;
-        }
     }
-    
+    vm_prot_t currentProtection, maxProtection;
+    kern_return_t result = 
+        vm_remap(mach_task_self(), &codeAddress, PAGE_MAX_SIZE, 
+                 0, VM_FLAGS_FIXED | VM_FLAGS_OVERWRITE, 
+                 mach_task_self(), codePage, TRUE, 
+                 &currentProtection, &maxProtection, VM_INHERIT_SHARE);
     if (result != KERN_SUCCESS) {
-        return nil; 
+        mach_error("vm_remap failed", result);
+        return nil;
     }
-    
-    TrampolineBlockPagePair *pagePair = (TrampolineBlockPagePair *) dataAddress;
+
     pagePair->nextAvailable = pagePair->startIndex();
-    pagePair->nextPagePair = nil;
-    pagePair->nextAvailablePage = nil;
-    
-    if (headPagePair) {
-        TrampolineBlockPagePair *lastPagePair = headPagePair;
-        while(lastPagePair->nextPagePair)
-            lastPagePair = lastPagePair->nextPagePair;
-        
-        lastPagePair->nextPagePair = pagePair;
-        headPagePairs[aMode]->nextAvailablePage = pagePair;
-    } else {
-        headPagePairs[aMode] = pagePair;
-    }
-    
+    pagePair->argumentMode = aMode;
+    pagePair->number = number;
+    trampolinePairCount++;
+
+    _setPagePairAvailable(pagePair, true);
     return pagePair;
 }
 
@@ -295,40 +342,49 @@ static TrampolineBlockPagePair *
 _getOrAllocatePagePairWithNextAvailable(ArgumentMode aMode) 
 {
     _assert_locked();
-    
-    TrampolineBlockPagePair *headPagePair = headPagePairs[aMode];
 
-    if (!headPagePair)
-        return _allocateTrampolinesAndData(aMode);
-    
-    // make sure head page is filled first
-    if (headPagePair->nextAvailable != headPagePair->endIndex())
-        return headPagePair;
-    
-    if (headPagePair->nextAvailablePage) // check if there is a page w/a hole
-        return headPagePair->nextAvailablePage;
+    // Fill the lowest-numbered page pair with a hole first.
+    uintptr_t *bits = availablePagePairs[aMode];
+    size_t words = trampolineRegionCount * TRAMPOLINE_REGION_PAIRS / WORD_BITS;
+    for (size_t word = availablePagePairsHint[aMode]; word < words; word++) {
+        if (bits[word]) {
+            availablePagePairsHint[aMode] = word;
+            return _pagePairForNumber(word * WORD_BITS + 
+                                      __builtin_ctzl(bits[word]));
+        }
+    }
+    availablePagePairsHint[aMode] = words;
     
     return _allocateTrampolinesAndData(aMode); // tack on a new one
 }
 
 static TrampolineBlockPagePair *
-_pageAndIndexContainingIMP(IMP anImp, uintptr_t *outIndex, 
-                           TrampolineBlockPagePair **outHeadPagePair) 
+_pageAndIndexContainingIMP(IMP anImp, uintptr_t *outIndex) 
 {
     _assert_locked();
 
-    for (int arg = 0; arg < ArgumentModeCount; arg++) {
-        for (TrampolineBlockPagePair *pagePair = headPagePairs[arg]; 
-             pagePair;
-             pagePair = pagePair->nextPagePair)
+    uintptr_t address = (uintptr_t)anImp;
+    for (size_t r = 0; r < trampolineRegionCount; r++) {
+        uintptr_t region = trampolineRegions[r];
+        if (address < region  ||  
+            address - region >= TrampolineBlockPagePair::regionSize()) 
         {
-            uintptr_t index = pagePair->indexForTrampoline(anImp);
-            if (index) {
-                if (outIndex) *outIndex = index;
-                if (outHeadPagePair) *outHeadPagePair = headPagePairs[arg];
-                return pagePair;
-            }
+            continue;
+        }
+
+        size_t position = 
+            (address - region) / TrampolineBlockPagePair::pairSize();
+        if (r * TRAMPOLINE_REGION_PAIRS + position >= trampolinePairCount) {
+            return nil;
         }
+
+        TrampolineBlockPagePair *pagePair = (TrampolineBlockPagePair *)
+            (region + position * TrampolineBlockPagePair::pairSize());
+        uintptr_t index = pagePair->indexForTrampoline(anImp);
+        if (!index) return nil;
+
+        if (outIndex) *outIndex = index;
+        return pagePair;
     }
     
     return nil;
@@ -361,8 +417,7 @@ _imp_implementationWithBlockNoCopy(id block)
 
     TrampolineBlockPagePair *pagePair = 
         _getOrAllocatePagePairWithNextAvailable(aMode);
-    if (!headPagePairs[aMode])
-        headPagePairs[aMode] = pagePair;
+    if (!pagePair) return nil;
 
     uintptr_t index = pagePair->nextAvailable;
     assert(index >= pagePair->startIndex()  &&  index < pagePair->endIndex());
@@ -377,15 +432,7 @@ _imp_implementationWithBlockNoCopy(id block)
     pagePair->nextAvailable = nextAvailableIndex;
     if (nextAvailableIndex == pagePair->endIndex()) {
         // PagePair is now full (free list or wilderness exhausted)
-        // Remove from available page linked list
-        TrampolineBlockPagePair *iterator = headPagePairs[aMode];
-        while(iterator && (iterator->nextAvailablePage != pagePair)) {
-            iterator = iterator->nextAvailablePage;
-        }
-        if (iterator) {
-            iterator->nextAvailablePage = pagePair->nextAvailablePage;
-            pagePair->nextAvailablePage = nil;
-        }
+        _setPagePairAvailable(pagePair, false);
     }
     
     payload->block = block;
@@ -412,7 +459,7 @@ id imp_getBlock(IMP anImp) {
     
     _lock();
     
-    pagePair = _pageAndIndexContainingIMP(anImp, &index, nil);
+    pagePair = _pageAndIndexContainingIMP(anImp, &index);
     
     if (!pagePair) {
         _unlock();
@@ -434,13 +481,12 @@ id imp_getBlock(IMP anImp) {
 
 BOOL imp_removeBlock(IMP anImp) {
     TrampolineBlockPagePair *pagePair;
-    TrampolineBlockPagePair *headPagePair;
     uintptr_t index;
     
     if (!anImp) return NO;
     
     _lock();
-    pagePair = _pageAndIndexContainingIMP(anImp, &index, &headPagePair);
+    pagePair = _pageAndIndexContainingIMP(anImp, &index);
     
     if (!pagePair) {
         _unlock();
@@ -454,22 +500,8 @@ BOOL imp_removeBlock(IMP anImp) {
     payload->nextAvailable = pagePair->nextAvailable;
     pagePair->nextAvailable = index;
     
-    // make sure this page is on available linked list
-    TrampolineBlockPagePair *pagePairIterator = headPagePair;
-    
-    // see if page is the next available page for any existing pages
-    while (pagePairIterator->nextAvailablePage && 
-           pagePairIterator->nextAvailablePage != pagePair)
-    {
-        pagePairIterator = pagePairIterator->nextAvailablePage;
-    }
-    
-    if (! pagePairIterator->nextAvailablePage) {
-        // if iteration stopped because nextAvail was nil
-        // add to end of list.
-        pagePairIterator->nextAvailablePage = pagePair;
-        pagePair->nextAvailablePage = nil;
-    }
+    // make sure this page is available for allocation
+    _setPagePairAvailable(pagePair, true);
     
     _unlock();
     Block_release(block);
@@ -16,6 +16,8 @@ extern void cache_delete(Class cls);
 
 extern void cache_collect(bool collectALot);
 
+extern void cache_collect_unlocked(void);
+
 __END_DECLS
 
 #endif
@@ -54,11 +54,22 @@
  *
  * All functions that modify cache data or structures must acquire the 
  * cacheUpdateLock to prevent interference from concurrent modifications.
- * The function that frees cache garbage must acquire the cacheUpdateLock 
- * and use collecting_in_critical() to flush out cache readers.
  * The cacheUpdateLock is also used to protect the custom allocator used 
  * for large method cache blocks.
  *
+ * Garbage is freed in batches. cache_fill detaches the current garbage 
+ * list as a batch while holding cacheUpdateLock, then drops the lock 
+ * and uses collecting_in_critical() to wait out the cache readers. 
+ * Everything in the batch was already disconnected when it was detached, 
+ * so once every thread has been seen outside objc_msgSend the batch can 
+ * be freed. Other cache fills proceed while the PC scan runs. If readers 
+ * do not drain quickly, the batch is returned to the garbage list and 
+ * retried by a later fill.
+ * Cache flushes collect the same way after dropping the lock, so 
+ * garbage from flushes is freed even if no cache_fill follows.
+ * Only cache_collect(true) collects under the lock, spinning until 
+ * readers are out.
+ *
  * Cache readers (PC-checked by collecting_in_critical())
  * objc_msgSend*
  * cache_getImp
@@ -72,6 +83,20 @@
  * cache_flush        (only called from cache_fill and flush_caches)
  * cache_collect_free (only called from cache_expand and cache_flush)
  *
+ * Garbage collectors (acquire cacheUpdateLock only to detach or 
+ * reattach a batch; PC scan and free run unlocked)
+ * cache_collect_unlocked (called from cache_fill and flushCaches after 
+ *                         dropping the lock)
+ *
+ * Shrinking a cache breaks the rule that mask only grows: a reader 
+ * holding the old mask would overrun smaller buckets. So a sparse cache 
+ * shrinks in two steps. cache_erase_nolock installs the shared empty 
+ * buckets of the old capacity with the smaller mask, which is safe with 
+ * either mask. The next fill allocates small buckets only if a garbage 
+ * collection has since seen every thread outside the cache readers; 
+ * otherwise it refills at the old capacity. cache_epoch and 
+ * cache_safe_epoch track that.
+ *
  * UNPROTECTED cache readers (NOT thread-safe; used for debug info only)
  * cache_print
  * _class_printMethodCaches
@@ -99,14 +124,30 @@ static void _garbage_make_room(void);
 
 
 /***********************************************************************
-* Cache statistics for OBJC_PRINT_CACHE_SETUP
+* Cache statistics for OBJC_PRINT_CACHE_SETUP and _objc_getCacheStats
+* Recorded only when OBJC_PRINT_CACHE_SETUP or OBJC_DEBUG_CACHE_STATS 
+* is set. 
+* Cache locks: cacheUpdateLock must be held by the caller.
 **********************************************************************/
 static unsigned int cache_counts[16];
 static size_t cache_allocations;
 static size_t cache_collections;
+static size_t cache_shrinks;
+static size_t cache_deferred_shrinks;
+
+// Shrink epochs. See "Method cache locking" above.
+static uint32_t cache_epoch;
+static uint32_t cache_safe_epoch;
+
+static bool recordingCacheStats(void)
+{
+    return PrintCaches  ||  DebugCacheStats;
+}
 
 static void recordNewCache(mask_t capacity)
 {
+    if (!recordingCacheStats()) return;
+
     size_t bucket = log2u(capacity);
     if (bucket < countof(cache_counts)) {
         cache_counts[bucket]++;
@@ -116,6 +157,8 @@ static void recordNewCache(mask_t capacity)
 
 static void recordDeadCache(mask_t capacity)
 {
+    if (!recordingCacheStats()) return;
+
     size_t bucket = log2u(capacity);
     if (bucket < countof(cache_counts)) {
         cache_counts[bucket]--;
@@ -228,8 +271,24 @@ static inline mask_t cache_next(mask_t i, mask_t mask) {
 // Class points to cache. SEL is key. Cache buckets store SEL+IMP.
 // Caches are never built in the dyld shared cache.
 
+// CACHE_MIX_HASH folds higher selector bits into the bucket index.
+// Selectors copied by sel_registerName() are malloc-aligned, so 
+// masking alone leaves most buckets unused for them.
+// The messenger computes the same hash, so this is an opt-in build 
+// flag. Only the x86_64 messengers implement it.
+#ifndef CACHE_MIX_HASH
+#define CACHE_MIX_HASH 0
+#endif
+
+#if CACHE_MIX_HASH  &&  !__x86_64__
+#error CACHE_MIX_HASH is only implemented by the x86_64 messengers
+#endif
+
 static inline mask_t cache_hash(cache_key_t key, mask_t mask) 
 {
+#if CACHE_MIX_HASH
+    key ^= key >> 4;
+#endif
     return (mask_t)(key & mask);
 }
 
@@ -368,7 +427,7 @@ bucket_t *allocateBuckets(mask_t newCapacity)
     end->setImp((IMP)newBuckets);
 #endif
     
-    if (PrintCaches) recordNewCache(newCapacity);
+    recordNewCache(newCapacity);
 
     return newBuckets;
 }
@@ -382,7 +441,7 @@ size_t cache_t::bytesForCapacity(uint32_t cap)
 
 bucket_t *allocateBuckets(mask_t newCapacity)
 {
-    if (PrintCaches) recordNewCache(newCapacity);
+    recordNewCache(newCapacity);
 
     return (bucket_t *)calloc(cache_t::bytesForCapacity(newCapacity), 1);
 }
@@ -390,6 +449,9 @@ bucket_t *allocateBuckets(mask_t newCapacity)
 #endif
 
 
+static bucket_t **emptyBucketsList = nil;
+static mask_t emptyBucketsListCount = 0;
+
 bucket_t *emptyBucketsForCapacity(mask_t capacity, bool allocate = true)
 {
     cacheUpdateLock.assertLocked();
@@ -402,9 +464,6 @@ bucket_t *emptyBucketsForCapacity(mask_t capacity, bool allocate = true)
     }
 
     // Use shared empty buckets allocated on the heap.
-    static bucket_t **emptyBucketsList = nil;
-    static mask_t emptyBucketsListCount = 0;
-    
     mask_t index = log2u(capacity);
 
     if (index >= emptyBucketsListCount) {
@@ -431,11 +490,23 @@ bucket_t *emptyBucketsForCapacity(mask_t capacity, bool allocate = true)
 }
 
 
+// Returns true if b is one of the shared read-only bucket arrays.
+// A shrinking cache may use the empty buckets of a larger capacity.
+static bool isEmptyBuckets(bucket_t *b)
+{
+    if (b == (bucket_t *)&_objc_empty_cache) return true;
+    for (mask_t i = 0; i < emptyBucketsListCount; i++) {
+        if (b == emptyBucketsList[i]) return true;
+    }
+    return false;
+}
+
+
 bool cache_t::isConstantEmptyCache()
 {
     return 
         occupied() == 0  &&  
-        buckets() == emptyBucketsForCapacity(capacity(), false);
+        isEmptyBuckets(buckets());
 }
 
 bool cache_t::canBeFreed()
@@ -462,7 +533,7 @@ void cache_t::reallocate(mask_t oldCapacity, mask_t newCapacity)
     
     if (freeOld) {
         cache_collect_free(oldBuckets, oldCapacity);
-        cache_collect(false);
+        // Collected by cache_fill after it drops cacheUpdateLock.
     }
 }
 
@@ -531,6 +602,48 @@ void cache_t::expand()
 }
 
 
+// Smallest capacity that holds occupied entries below 3/4 full.
+static mask_t cache_capacity_for(mask_t occupied)
+{
+    mask_t capacity = INIT_CACHE_SIZE;
+    while (occupied + 1 > capacity / 4 * 3) capacity *= 2;
+    return capacity;
+}
+
+
+/***********************************************************************
+* cache_refill_capacity
+* Returns the capacity for refilling cls's empty cache. 
+* Finishes or abandons a shrink started by cache_erase_nolock.
+* Cache locks: cacheUpdateLock must be held by the caller.
+**********************************************************************/
+static mask_t cache_refill_capacity(Class cls, mask_t capacity)
+{
+    cacheUpdateLock.assertLocked();
+
+    auto extra = cls->data()->extraIfExists();
+    mask_t shrinkCapacity = extra ? extra->cacheShrinkCapacity : 0;
+    if (!shrinkCapacity) return capacity ?: INIT_CACHE_SIZE;
+
+    extra->cacheShrinkCapacity = 0;
+    if ((int32_t)(extra->cacheShrinkEpoch - cache_safe_epoch) <= 0) {
+        // Every reader of the old mask is gone.
+        if (recordingCacheStats()) cache_shrinks++;
+        if (PrintCaches) {
+            _objc_inform("CACHES: shrinking %s%s cache from %u to %u", 
+                         cls->nameForLogging(), 
+                         cls->isMetaClass() ? " (meta)" : "", 
+                         (unsigned)shrinkCapacity, (unsigned)capacity);
+        }
+        return capacity;
+    }
+
+    // A reader may still hold the old mask. Keep the old capacity.
+    if (recordingCacheStats()) cache_deferred_shrinks++;
+    return shrinkCapacity;
+}
+
+
 static void cache_fill_nolock(Class cls, SEL sel, IMP imp, id receiver)
 {
     cacheUpdateLock.assertLocked();
@@ -550,7 +663,7 @@ static void cache_fill_nolock(Class cls, SEL sel, IMP imp, id receiver)
     mask_t capacity = cache->capacity();
     if (cache->isConstantEmptyCache()) {
         // Cache is read-only. Replace it.
-        cache->reallocate(capacity, capacity ?: INIT_CACHE_SIZE);
+        cache->reallocate(capacity, cache_refill_capacity(cls, capacity));
     }
     else if (newOccupied <= capacity / 4 * 3) {
         // Cache is less than 3/4 full. Use it as-is.
@@ -566,13 +679,21 @@ static void cache_fill_nolock(Class cls, SEL sel, IMP imp, id receiver)
     bucket_t *bucket = cache->find(key, receiver);
     if (bucket->key() == 0) cache->incrementOccupied();
     bucket->set(key, imp);
+
+    auto extra = cls->data()->extraIfExists();
+    if (extra  &&  cache->occupied() > extra->cachePeakOccupied) {
+        extra->cachePeakOccupied = cache->occupied();
+    }
 }
 
 void cache_fill(Class cls, SEL sel, IMP imp, id receiver)
 {
 #if !DEBUG_TASK_THREADS
-    mutex_locker_t lock(cacheUpdateLock);
-    cache_fill_nolock(cls, sel, imp, receiver);
+    {
+        mutex_locker_t lock(cacheUpdateLock);
+        cache_fill_nolock(cls, sel, imp, receiver);
+    }
+    cache_collect_unlocked();
 #else
     _collecting_in_critical();
     return;
@@ -581,7 +702,10 @@ void cache_fill(Class cls, SEL sel, IMP imp, id receiver)
 
 
 // Reset this entire cache to the uncached lookup by reallocating it.
-// This must not shrink the cache - that breaks the lock-free scheme.
+// This must not shrink the buckets - that breaks the lock-free scheme.
+// A cache that stayed sparse for two flush intervals gets a smaller 
+// mask here and smaller buckets at its next fill; see 
+// "Method cache locking" above.
 void cache_erase_nolock(Class cls)
 {
     cacheUpdateLock.assertLocked();
@@ -590,12 +714,42 @@ void cache_erase_nolock(Class cls)
 
     mask_t capacity = cache->capacity();
     if (capacity > 0  &&  cache->occupied() > 0) {
+        // The peak is tracked only once the class has extra data. 
+        // Until then the current occupancy stands in for it.
+        auto rw = cls->data();
+        auto extra = rw->extraIfExists();
+        mask_t peak = cache->occupied();
+        if (extra) peak = MAX(peak, extra->cachePeakOccupied);
+
+        // A cache that was not sparse this interval cannot shrink at 
+        // the next flush either, so it needs no history.
+        if (!extra  &&  cache_capacity_for(peak) <= capacity / 4) {
+            extra = rw->extra();
+        }
+
+        mask_t newCapacity = capacity;
+        if (extra) {
+            bool haveHistory = extra->cachePrevPeakOccupied > 0;
+            mask_t wanted = 
+                cache_capacity_for(MAX(peak, extra->cachePrevPeakOccupied));
+            extra->cachePrevPeakOccupied = peak;
+            extra->cachePeakOccupied = 0;
+
+            if (haveHistory  &&  wanted <= capacity / 4  &&  
+                !extra->cacheShrinkCapacity) 
+            {
+                newCapacity = wanted;
+                extra->cacheShrinkCapacity = capacity;
+                extra->cacheShrinkEpoch = ++cache_epoch;
+            }
+        }
+
         auto oldBuckets = cache->buckets();
         auto buckets = emptyBucketsForCapacity(capacity);
-        cache->setBucketsAndMask(buckets, capacity - 1); // also clears occupied
+        cache->setBucketsAndMask(buckets, newCapacity - 1); // also clears occupied
 
         cache_collect_free(oldBuckets, capacity);
-        cache_collect(false);
+        // Collected by flushCaches after it drops cacheUpdateLock.
     }
 }
 
@@ -604,12 +758,34 @@ void cache_delete(Class cls)
 {
     mutex_locker_t lock(cacheUpdateLock);
     if (cls->cache.canBeFreed()) {
-        if (PrintCaches) recordDeadCache(cls->cache.capacity());
+        recordDeadCache(cls->cache.capacity());
         free(cls->cache.buckets());
     }
 }
 
 
+/***********************************************************************
+* _objc_getCacheStats
+* Copies the method cache statistics into stats.
+* Cache locks: acquires cacheUpdateLock
+**********************************************************************/
+void _objc_getCacheStats(struct objc_cache_stats *stats)
+{
+    if (!stats) return;
+
+    mutex_locker_t lock(cacheUpdateLock);
+    static_assert(countof(stats->liveCaches) == countof(cache_counts), 
+                  "cache statistics size mismatch");
+    for (size_t i = 0; i < countof(cache_counts); i++) {
+        stats->liveCaches[i] = cache_counts[i];
+    }
+    stats->allocations = cache_allocations;
+    stats->collections = cache_collections;
+    stats->shrinks = cache_shrinks;
+    stats->deferredShrinks = cache_deferred_shrinks;
+}
+
+
 /***********************************************************************
 * cache collection.
 **********************************************************************/
@@ -747,6 +923,8 @@ static int _collecting_in_critical(void)
 **********************************************************************/
 
 // amount of memory represented by all refs in the garbage
+// Written with cacheUpdateLock held. cache_collect_unlocked() reads it 
+// without the lock, so every access is atomic.
 static size_t garbage_byte_size = 0;
 
 // do not empty the garbage until garbage_byte_size gets at least this big
@@ -766,14 +944,28 @@ enum {
     INIT_GARBAGE_COUNT = 128
 };
 
-static void _garbage_make_room(void)
+// number of unlocked PC scans to try before giving a batch back
+enum {
+    GARBAGE_BATCH_RETRIES = 4
+};
+
+static inline size_t garbage_get_byte_size(void)
+{
+    return __atomic_load_n(&garbage_byte_size, __ATOMIC_RELAXED);
+}
+
+static inline void garbage_set_byte_size(size_t size)
 {
-    static int first = 1;
+    cacheUpdateLock.assertLocked();
+    __atomic_store_n(&garbage_byte_size, size, __ATOMIC_RELAXED);
+}
 
-    // Create the collection table the first time it is needed
-    if (first)
+static void _garbage_make_room(void)
+{
+    // Create the collection table when it is needed.
+    // It is missing the first time and after a batch is detached.
+    if (!garbage_refs)
     {
-        first = 0;
         garbage_refs = (bucket_t**)
             malloc(INIT_GARBAGE_COUNT * sizeof(void *));
         garbage_max = INIT_GARBAGE_COUNT;
@@ -800,14 +992,124 @@ static void cache_collect_free(bucket_t *data, mask_t capacity)
 {
     cacheUpdateLock.assertLocked();
 
-    if (PrintCaches) recordDeadCache(capacity);
+    recordDeadCache(capacity);
 
     _garbage_make_room ();
-    garbage_byte_size += cache_t::bytesForCapacity(capacity);
+    garbage_set_byte_size(garbage_get_byte_size() + 
+                          cache_t::bytesForCapacity(capacity));
     garbage_refs[garbage_count++] = data;
 }
 
 
+/***********************************************************************
+* garbage_batch_t
+* Garbage detached from garbage_refs for freeing without cacheUpdateLock.
+* Every bucket list in a batch was disconnected before the batch was 
+* detached, so only cache readers already running at that point can 
+* still be using it.
+**********************************************************************/
+struct garbage_batch_t {
+    bucket_t **refs;
+    size_t count;
+    size_t byteSize;
+    uint32_t epoch;  // cache_epoch when the batch was detached
+};
+
+static bool garbage_detach(garbage_batch_t& batch)
+{
+    cacheUpdateLock.assertLocked();
+
+    if (garbage_get_byte_size() < garbage_threshold) return false;
+
+    batch.refs = garbage_refs;
+    batch.count = garbage_count;
+    batch.byteSize = garbage_get_byte_size();
+    batch.epoch = cache_epoch;
+
+    garbage_refs = nil;
+    garbage_count = 0;
+    garbage_max = 0;
+    garbage_set_byte_size(0);
+
+    return true;
+}
+
+static void garbage_reattach(garbage_batch_t& batch)
+{
+    cacheUpdateLock.assertLocked();
+
+    for (size_t i = 0; i < batch.count; i++) {
+        _garbage_make_room();
+        garbage_refs[garbage_count++] = batch.refs[i];
+    }
+    garbage_set_byte_size(garbage_get_byte_size() + batch.byteSize);
+
+    free(batch.refs);
+}
+
+static void garbage_free(garbage_batch_t& batch)
+{
+    // Erase each entry so debugging tools don't see stale pointers.
+    while (batch.count--) {
+        auto dead = batch.refs[batch.count];
+        batch.refs[batch.count] = nil;
+        free(dead);
+    }
+    free(batch.refs);
+}
+
+
+/***********************************************************************
+* cache_collect_unlocked.  Try to free accumulated dead caches without 
+* holding cacheUpdateLock during the PC scan.
+* Cache locks: cacheUpdateLock must NOT be held by the caller.
+**********************************************************************/
+void cache_collect_unlocked(void)
+{
+    // Unlocked check; a stale value only delays collection until the 
+    // next fill or flush.
+    if (garbage_get_byte_size() < garbage_threshold) return;
+
+    garbage_batch_t batch;
+    {
+        mutex_locker_t lock(cacheUpdateLock);
+        // Another thread may have taken the garbage already.
+        if (!garbage_detach(batch)) return;
+    }
+
+    // Synchronize collection with objc_msgSend and other cache readers.
+    // Cache fills continue while we wait.
+    for (unsigned tries = 0; _collecting_in_critical(); tries++) {
+        if (tries == GARBAGE_BATCH_RETRIES) {
+            // Readers are still busy. Let a later fill or flush retry.
+            if (PrintCaches) {
+                _objc_inform ("CACHES: not collecting; "
+                              "objc_msgSend in progress");
+            }
+            mutex_locker_t lock(cacheUpdateLock);
+            garbage_reattach(batch);
+            return;
+        }
+        sched_yield();
+    }
+
+    // No cache readers in progress - batch is now deletable
+
+    {
+        mutex_locker_t lock(cacheUpdateLock);
+        if (recordingCacheStats()) cache_collections++;
+        if ((int32_t)(batch.epoch - cache_safe_epoch) > 0) {
+            cache_safe_epoch = batch.epoch;
+        }
+        if (PrintCaches) {
+            _objc_inform ("CACHES: COLLECTING %zu bytes (%zu allocations, %zu collections)", batch.byteSize, cache_allocations, cache_collections);
+        }
+    }
+
+    garbage_free(batch);
+}
+
+
 /***********************************************************************
 * cache_collect.  Try to free accumulated dead caches.
 * collectALot tries harder to free memory.
@@ -818,10 +1120,12 @@ void cache_collect(bool collectALot)
     cacheUpdateLock.assertLocked();
 
     // Done if the garbage is not full
-    if (garbage_byte_size < garbage_threshold  &&  !collectALot) {
+    if (garbage_get_byte_size() < garbage_threshold  &&  !collectALot) {
         return;
     }
 
+    uint32_t epoch = cache_epoch;
+
     // Synchronize collection with objc_msgSend and other cache readers
     if (!collectALot) {
         if (_collecting_in_critical ()) {
@@ -841,11 +1145,12 @@ void cache_collect(bool collectALot)
     }
 
     // No cache readers in progress - garbage is now deletable
+    cache_safe_epoch = epoch;
+    if (recordingCacheStats()) cache_collections++;
 
     // Log our progress
     if (PrintCaches) {
-        cache_collections++;
-        _objc_inform ("CACHES: COLLECTING %zu bytes (%zu allocations, %zu collections)", garbage_byte_size, cache_allocations, cache_collections);
+        _objc_inform ("CACHES: COLLECTING %zu bytes (%zu allocations, %zu collections)", garbage_get_byte_size(), cache_allocations, cache_collections);
     }
     
     // Dispose all refs now in the garbage
@@ -858,7 +1163,7 @@ void cache_collect(bool collectALot)
     
     // Clear the garbage count and total size indicator
     garbage_count = 0;
-    garbage_byte_size = 0;
+    garbage_set_byte_size(0);
 
     if (PrintCaches) {
         size_t i;
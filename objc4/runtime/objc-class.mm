@@ -273,6 +273,23 @@ static bool isScanned(ptrdiff_t ivar_offset, const uint8_t *layout)
 }
 
 
+// Returns YES if the word at localOffset in cls's own ivars is 
+// in cls's strong or weak ARC ivar layout.
+static bool isScannedIvar(Class cls, ptrdiff_t localOffset, bool weak)
+{
+#if __OBJC2__
+    layout_bitmap bits = _class_getIvarLayoutBitmap(cls, weak);
+    if (bits.bits) {
+        if (localOffset < 0) return NO;
+        size_t bit = (size_t)localOffset / sizeof(id);
+        return bit < bits.bitCount  &&  (bits.bits[bit/8] & (1 << (bit % 8)));
+    }
+#endif
+    return isScanned(localOffset, weak ? class_getWeakIvarLayout(cls)
+                                       : class_getIvarLayout(cls));
+}
+
+
 /***********************************************************************
 * _class_lookUpIvar
 * Given an object and an ivar in it, look up some data about that ivar:
@@ -307,12 +324,12 @@ _class_lookUpIvar(Class cls, Ivar ivar, ptrdiff_t& ivarOffset,
             ptrdiff_t localOffset = 
                 ivarOffset - ivarCls->alignedInstanceStart();
 
-            if (isScanned(localOffset, class_getIvarLayout(ivarCls))) {
+            if (isScannedIvar(ivarCls, localOffset, NO)) {
                 memoryManagement = objc_ivar_memoryStrong;
                 return;
             }
             
-            if (isScanned(localOffset, class_getWeakIvarLayout(ivarCls))) {
+            if (isScannedIvar(ivarCls, localOffset, YES)) {
                 memoryManagement = objc_ivar_memoryWeak;
                 return;
             }
@@ -962,7 +979,7 @@ _objc_constructOrFree(id bytes, Class cls)
     assert(cls->hasCxxCtor());  // for performance, not correctness
 
     id obj = object_cxxConstructFromClass(bytes, cls);
-    if (!obj) free(bytes);
+    if (!obj) object_free(bytes);
 
     return obj;
 }
@@ -159,6 +159,15 @@
 #   define SUPPORT_QOS_HACK 1
 #endif
 
+// Define SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS to combine consecutive 
+// autorelease pool entries for the same object into one entry 
+// with a repeat count in the pointer's unused high bits.
+#if __LP64__  &&  !TARGET_OS_WIN32
+#   define SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS 1
+#else
+#   define SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS 0
+#endif
+
 // OBJC_INSTRUMENTED controls whether message dispatching is dynamically
 // monitored.  Monitoring introduces substantial overhead.
 // NOTE: To define this condition, do so in the build command, NOT by
@@ -29,6 +29,8 @@ OPTION( PrintRawIsa,              OBJC_PRINT_RAW_ISA,              "log classes
 OPTION( DebugUnload,              OBJC_DEBUG_UNLOAD,               "warn about poorly-behaving bundles when unloaded")
 OPTION( DebugFragileSuperclasses, OBJC_DEBUG_FRAGILE_SUPERCLASSES, "warn about subclasses that may have been broken by subsequent changes to superclasses")
 OPTION( DebugNilSync,             OBJC_DEBUG_NIL_SYNC,             "warn about @synchronized(nil), which does no synchronization")
+OPTION( DebugSyncStats,           OBJC_DEBUG_SYNC_STATS,           "record @synchronized cache hits and lock contention for _objc_sync_getStats()")
+OPTION( DebugCacheStats,          OBJC_DEBUG_CACHE_STATS,          "record method cache allocations, collections, and shrinks for _objc_getCacheStats()")
 OPTION( DebugNonFragileIvars,     OBJC_DEBUG_NONFRAGILE_IVARS,     "capriciously rearrange non-fragile ivars")
 OPTION( DebugAltHandlers,         OBJC_DEBUG_ALT_HANDLERS,         "record more info about bad alt handler use")
 OPTION( DebugMissingPools,        OBJC_DEBUG_MISSING_POOLS,        "warn about autorelease with no pool in place, which may be a leak")
@@ -40,3 +42,5 @@ OPTION( DisableVtables,           OBJC_DISABLE_VTABLES,            "disable vtab
 OPTION( DisablePreopt,            OBJC_DISABLE_PREOPTIMIZATION,    "disable preoptimization courtesy of dyld shared cache")
 OPTION( DisableTaggedPointers,    OBJC_DISABLE_TAGGED_POINTERS,    "disable tagged pointer optimization of NSNumber et al.") 
 OPTION( DisableNonpointerIsa,     OBJC_DISABLE_NONPOINTER_ISA,     "disable non-pointer isa fields")
+OPTION( LazyMethodListFixup,      OBJC_LAZY_METHOD_LIST_FIXUP,     "defer uniquing and sorting of class method lists until first use")
+OPTION( DisableAutoreleaseCoalescing, OBJC_DISABLE_AUTORELEASE_COALESCING, "disable coalescing of consecutive autorelease pool entries for the same object")
@@ -27,6 +27,7 @@
 #if __OBJC2__
 
 #include "objc-runtime-new.h"
+#include "objc-selopt.h"
 
 // classref_t is not fixed up at launch; use remapClass() to convert
 
@@ -40,6 +41,7 @@ extern category_t **_getObjc2CategoryList(const header_info *hi, size_t *count);
 extern category_t **_getObjc2NonlazyCategoryList(const header_info *hi, size_t *count);
 extern protocol_t **_getObjc2ProtocolList(const header_info *hi, size_t *count);
 extern protocol_t **_getObjc2ProtocolRefs(const header_info *hi, size_t *count);
+extern objc_image_selopt_t *_getObjc2ImageSelopt(const header_info *hi, size_t *outBytes);
 using Initializer = void(*)(void);
 extern Initializer* getLibobjcInitializers(const header_info *hi, size_t *count);
 
@@ -76,6 +76,14 @@ _getObjcImageInfo(const headerType *mhdr, size_t *outBytes)
 }
 
 
+objc_image_selopt_t *
+_getObjc2ImageSelopt(const header_info *hi, size_t *outBytes)
+{
+    return getDataSection<objc_image_selopt_t>(hi->mhdr(), "__objc_selopt", 
+                                               outBytes, nil);
+}
+
+
 static const segmentType *
 getsegbynamefromheader(const headerType *mhdr, const char *segname)
 {
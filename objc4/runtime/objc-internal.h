@@ -522,6 +522,36 @@ OBJC_EXPORT id objc_autorelease(id obj)
     __asm__("_objc_autorelease")
     OBJC_AVAILABLE(10.7, 5.0, 9.0, 1.0);
 
+// Retain or release every object in objs[0..count-1].
+// nil and tagged pointer objects are skipped.
+// objc_releaseBatch() sends -dealloc only after all of the releases.
+OBJC_EXPORT
+void
+objc_retainBatch(id *objs, size_t count)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
+OBJC_EXPORT
+void
+objc_releaseBatch(id *objs, size_t count)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
+// Deferred deallocation. An object that defers still runs its -dealloc 
+// methods on the releasing thread, and its weak references are cleared 
+// there before -dealloc returns. Its C++ destructors, ARC ivar cleanup, 
+// associated objects, and memory are released later on a background queue.
+// objc_setThreadDefersDealloc() covers objects deallocated on the calling 
+// thread. objc_setClassDefersDealloc() covers instances of cls and its 
+// subclasses.
+OBJC_EXPORT
+void
+objc_setThreadDefersDealloc(BOOL defer)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
+OBJC_EXPORT
+void
+objc_setClassDefersDealloc(Class cls, BOOL defer)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
 // Prepare a value at +1 for return through a +0 autoreleasing convention.
 OBJC_EXPORT
 id
@@ -607,6 +637,82 @@ void
 _objc_autoreleasePoolPrint(void)
     OBJC_AVAILABLE(10.7, 5.0, 9.0, 1.0);
 
+// Logs lock contention counts for the retain count and weak reference 
+// side tables. Debugging only.
+OBJC_EXPORT
+void
+_objc_sideTablePrint(void)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
+// @synchronized statistics. Counted only when OBJC_DEBUG_SYNC_STATS is set.
+struct objc_sync_stats {
+    uint64_t fastCacheHits;        // found in the per-thread single-entry cache
+    uint64_t threadCacheHits;      // found in the per-thread SyncCache
+    uint64_t listSearches;         // searched the shared SyncData lists
+    uint64_t uncontendedAcquires;  // objc_sync_enter took a free lock
+    uint64_t spinAcquires;         // objc_sync_enter took the lock while spinning
+    uint64_t blockingAcquires;     // objc_sync_enter blocked in the kernel
+};
+
+OBJC_EXPORT
+void
+_objc_sync_getStats(struct objc_sync_stats *stats)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
+// Method cache statistics. Counted only when OBJC_DEBUG_CACHE_STATS 
+// or OBJC_PRINT_CACHE_SETUP is set.
+struct objc_cache_stats {
+    size_t liveCaches[16];   // allocated caches, indexed by log2(capacity)
+    size_t allocations;      // bucket arrays ever allocated
+    size_t collections;      // garbage collections of dead bucket arrays
+    size_t shrinks;          // sparse caches refilled at a smaller capacity
+    size_t deferredShrinks;  // shrinks abandoned because readers were busy
+};
+
+OBJC_EXPORT
+void
+_objc_getCacheStats(struct objc_cache_stats *stats)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
+// Slab allocation of small instances.
+// Instances of cls and its subclasses of up to 256 bytes are allocated 
+// from per-thread slab magazines instead of malloc. Such instances are 
+// not malloc blocks: malloc_size() returns 0 for them and free() on 
+// them corrupts the heap. Do not free() them yourself; dispose of them 
+// with object_dispose() or -dealloc. Do not opt in classes whose 
+// instances are freed or measured with malloc APIs by other code, 
+// such as toll-free bridged CF types.
+OBJC_EXPORT
+void
+objc_setClassUsesSlab(Class cls, BOOL useSlab)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
+// Slab statistics. Size class i holds objects of (i+1)*16 bytes.
+// carved - available is the number of objects that are live 
+// or cached by some thread.
+#define OBJC_SLAB_SIZE_CLASSES 16
+struct objc_slab_stats {
+    size_t chunks;                             // chunks in use
+    size_t chunkSize;                          // bytes per chunk
+    size_t carved[OBJC_SLAB_SIZE_CLASSES];     // objects ever carved
+    size_t available[OBJC_SLAB_SIZE_CLASSES];  // free objects in the depot
+};
+
+OBJC_EXPORT
+void
+_objc_getSlabStats(struct objc_slab_stats *stats)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
+// Partial zero-fill of large instances.
+// Instances of cls and its subclasses of 256 bytes or more are zeroed 
+// only in their object ivars (and in every ivar of non-ARC classes). 
+// Other ivars of ARC classes start with garbage, so the classes' 
+// initializers must set every one of them.
+OBJC_EXPORT
+void
+objc_setClassSkipsZeroFill(Class cls, BOOL skip)
+    OBJC_AVAILABLE(10.13, 11.0, 11.0, 4.0);
+
 OBJC_EXPORT BOOL objc_should_deallocate(id object)
     OBJC_AVAILABLE(10.7, 5.0, 9.0, 1.0);
 
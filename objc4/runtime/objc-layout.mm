@@ -122,64 +122,110 @@ compress_layout(const uint8_t *bits, size_t bitmap_bits, bool weak)
 }
 
 
-static void set_bits(layout_bitmap bits, size_t which, size_t count)
+// Mask of the low n bits of a byte.
+static inline uint8_t low_bits(size_t n)
 {
-    // fixme optimize for byte/word at a time
-    size_t bit;
-    for (bit = which; bit < which + count  &&  bit < bits.bitCount; bit++) {
-        bits.bits[bit/8] |= 1 << (bit % 8);
-    }
-    if (bit == bits.bitCount  &&  bit < which + count) {
+    return n >= 8 ? 0xff : (uint8_t)((1u << n) - 1);
+}
+
+// Set or clear count bits starting at which, a byte at a time.
+static void fill_bits(layout_bitmap bits, size_t which, size_t count, bool set)
+{
+    size_t end = which + count;
+    if (end > bits.bitCount) {
         // couldn't fit full type in bitmap
-        _objc_fatal("layout bitmap too short");
+        if (which <= bits.bitCount) _objc_fatal("layout bitmap too short");
+        return;
+    }
+
+    // Leading partial byte, whole bytes, trailing partial byte.
+    while (which < end  &&  which % 8) {
+        if (set) bits.bits[which/8] |= 1 << (which % 8);
+        else bits.bits[which/8] &= ~(1 << (which % 8));
+        which++;
+    }
+    size_t bytes = (end - which) / 8;
+    memset(bits.bits + which/8, set ? 0xff : 0, bytes);
+    which += bytes * 8;
+    if (which < end) {
+        uint8_t mask = low_bits(end - which);
+        if (set) bits.bits[which/8] |= mask;
+        else bits.bits[which/8] &= ~mask;
     }
 }
 
+static void set_bits(layout_bitmap bits, size_t which, size_t count)
+{
+    fill_bits(bits, which, count, true);
+}
+
 static void clear_bits(layout_bitmap bits, size_t which, size_t count)
 {
-    // fixme optimize for byte/word at a time
-    size_t bit;
-    for (bit = which; bit < which + count  &&  bit < bits.bitCount; bit++) {
-        bits.bits[bit/8] &= ~(1 << (bit % 8));
-    }
-    if (bit == bits.bitCount  &&  bit < which + count) {
-        // couldn't fit full type in bitmap
-        _objc_fatal("layout bitmap too short");
+    fill_bits(bits, which, count, false);
+}
+
+
+// Read n <= 8 bits starting at pos.
+static inline uint8_t get_bits8(layout_bitmap bits, size_t pos, size_t n)
+{
+    size_t byte = pos / 8;
+    size_t shift = pos % 8;
+    unsigned value = bits.bits[byte] >> shift;
+    if (shift + n > 8) value |= (unsigned)bits.bits[byte+1] << (8 - shift);
+    return (uint8_t)value & low_bits(n);
+}
+
+// Write n <= 8 bits starting at pos.
+static inline void put_bits8(layout_bitmap bits, size_t pos, size_t n, 
+                             uint8_t value)
+{
+    size_t byte = pos / 8;
+    size_t shift = pos % 8;
+    unsigned mask = (unsigned)low_bits(n) << shift;
+    unsigned shifted = (unsigned)value << shift;
+    bits.bits[byte] = (uint8_t)((bits.bits[byte] & ~mask) | (shifted & mask));
+    if (shift + n > 8) {
+        mask >>= 8;
+        shifted >>= 8;
+        bits.bits[byte+1] = 
+            (uint8_t)((bits.bits[byte+1] & ~mask) | (shifted & mask));
     }
 }
 
 static void move_bits(layout_bitmap bits, size_t src, size_t dst, 
                       size_t count)
 {
-    // fixme optimize for byte/word at a time
-
-    if (dst == src) {
+    if (dst == src  ||  count == 0) {
         return;
     }
+    else if (src % 8 == dst % 8) {
+        // Same alignment: partial bytes at the ends, memmove between.
+        size_t head = (8 - src % 8) % 8;
+        if (head > count) head = count;
+        uint8_t first = head ? get_bits8(bits, src, head) : 0;
+        size_t bytes = (count - head) / 8;
+        size_t tail = count - head - bytes * 8;
+        uint8_t last = tail ? get_bits8(bits, src + head + bytes*8, tail) : 0;
+        memmove(bits.bits + (dst + head) / 8, bits.bits + (src + head) / 8, 
+                bytes);
+        if (head) put_bits8(bits, dst, head, first);
+        if (tail) put_bits8(bits, dst + head + bytes*8, tail, last);
+    }
     else if (dst > src) {
         // Copy backwards in case of overlap
         size_t pos = count;
-        while (pos--) {
-            size_t srcbit = src + pos;
-            size_t dstbit = dst + pos;
-            if (bits.bits[srcbit/8] & (1 << (srcbit % 8))) {
-                bits.bits[dstbit/8] |= 1 << (dstbit % 8);
-            } else {
-                bits.bits[dstbit/8] &= ~(1 << (dstbit % 8));
-            }
+        while (pos) {
+            size_t n = pos < 8 ? pos : 8;
+            pos -= n;
+            put_bits8(bits, dst + pos, n, get_bits8(bits, src + pos, n));
         }
     }
     else {
         // Copy forwards in case of overlap
         size_t pos;
-        for (pos = 0; pos < count; pos++) {
-            size_t srcbit = src + pos;
-            size_t dstbit = dst + pos;
-            if (bits.bits[srcbit/8] & (1 << (srcbit % 8))) {
-                bits.bits[dstbit/8] |= 1 << (dstbit % 8);
-            } else {
-                bits.bits[dstbit/8] &= ~(1 << (dstbit % 8));
-            }
+        for (pos = 0; pos < count; pos += 8) {
+            size_t n = count - pos < 8 ? count - pos : 8;
+            put_bits8(bits, dst + pos, n, get_bits8(bits, src + pos, n));
         }
     }
 }
@@ -407,26 +453,24 @@ layout_bitmap_splat(layout_bitmap dst, layout_bitmap src,
 {
     bool changed;
     size_t oldSrcBitCount;
-    size_t bit;
+    size_t byte;
 
     if (dst.bitCount < src.bitCount) _objc_fatal("layout bitmap too short");
 
     changed = NO;
     oldSrcBitCount = oldSrcInstanceSize / sizeof(id);
     
-    // fixme optimize for byte/word at a time
-    for (bit = 0; bit < oldSrcBitCount; bit++) {
-        int dstset = dst.bits[bit/8] & (1 << (bit % 8));
-        int srcset = (bit < src.bitCount) 
-            ? src.bits[bit/8] & (1 << (bit % 8))
+    for (byte = 0; byte * 8 < oldSrcBitCount; byte++) {
+        size_t bit = byte * 8;
+        uint8_t mask = low_bits(oldSrcBitCount - bit);
+        uint8_t srcbits = (bit < src.bitCount)
+            ? src.bits[byte] & low_bits(src.bitCount - bit)
             : 0;
-        if (dstset != srcset) {
+        uint8_t dstbits = dst.bits[byte];
+        uint8_t newbits = (dstbits & ~mask) | (srcbits & mask);
+        if (newbits != dstbits) {
             changed = YES;
-            if (srcset) {
-                dst.bits[bit/8] |= 1 << (bit % 8);
-            } else {
-                dst.bits[bit/8] &= ~(1 << (bit % 8));
-            }
+            dst.bits[byte] = newbits;
         }
     }
 
@@ -443,25 +487,28 @@ layout_bitmap_splat(layout_bitmap dst, layout_bitmap src,
 bool
 layout_bitmap_or(layout_bitmap dst, layout_bitmap src, const char *msg)
 {
-    bool changed = NO;
-    size_t bit;
+    uint8_t changed = 0;
+    size_t byte;
 
     if (dst.bitCount < src.bitCount) {
         _objc_fatal("layout_bitmap_or: layout bitmap too short%s%s", 
                     msg ? ": " : "", msg ? msg : "");
     }
     
-    // fixme optimize for byte/word at a time
-    for (bit = 0; bit < src.bitCount; bit++) {
-        int dstset = dst.bits[bit/8] & (1 << (bit % 8));
-        int srcset = src.bits[bit/8] & (1 << (bit % 8));
-        if (srcset  &&  !dstset) {
-            changed = YES;
-            dst.bits[bit/8] |= 1 << (bit % 8);
-        }
+    // Whole bytes, then the last partial byte.
+    // The compiler vectorizes the first loop.
+    size_t bytes = src.bitCount / 8;
+    for (byte = 0; byte < bytes; byte++) {
+        changed |= src.bits[byte] & ~dst.bits[byte];
+        dst.bits[byte] |= src.bits[byte];
+    }
+    if (src.bitCount % 8) {
+        uint8_t srcbits = src.bits[bytes] & low_bits(src.bitCount % 8);
+        changed |= srcbits & ~dst.bits[bytes];
+        dst.bits[bytes] |= srcbits;
     }
 
-    return changed;
+    return changed != 0;
 }
 
 
@@ -474,25 +521,64 @@ layout_bitmap_or(layout_bitmap dst, layout_bitmap src, const char *msg)
 bool
 layout_bitmap_clear(layout_bitmap dst, layout_bitmap src, const char *msg)
 {
-    bool changed = NO;
-    size_t bit;
+    uint8_t changed = 0;
+    size_t byte;
 
     if (dst.bitCount < src.bitCount) {
         _objc_fatal("layout_bitmap_clear: layout bitmap too short%s%s", 
                     msg ? ": " : "", msg ? msg : "");
     }
     
-    // fixme optimize for byte/word at a time
-    for (bit = 0; bit < src.bitCount; bit++) {
-        int dstset = dst.bits[bit/8] & (1 << (bit % 8));
-        int srcset = src.bits[bit/8] & (1 << (bit % 8));
-        if (srcset  &&  dstset) {
-            changed = YES;
-            dst.bits[bit/8] &= ~(1 << (bit % 8));
-        }
+    // Whole bytes, then the last partial byte.
+    // The compiler vectorizes the first loop.
+    size_t bytes = src.bitCount / 8;
+    for (byte = 0; byte < bytes; byte++) {
+        changed |= src.bits[byte] & dst.bits[byte];
+        dst.bits[byte] &= ~src.bits[byte];
+    }
+    if (src.bitCount % 8) {
+        uint8_t srcbits = src.bits[bytes] & low_bits(src.bitCount % 8);
+        changed |= srcbits & dst.bits[bytes];
+        dst.bits[bytes] &= ~srcbits;
     }
 
-    return changed;
+    return changed != 0;
+}
+
+
+/***********************************************************************
+* layout_bitmap_next
+* Returns the index of the first set bit at or after from, 
+* or bits.bitCount if there is none. Use it to iterate over the 
+* words of an ivar layout:
+*     for (i = layout_bitmap_next(bits, 0); i < bits.bitCount; 
+*          i = layout_bitmap_next(bits, i+1)) { ... }
+**********************************************************************/
+size_t
+layout_bitmap_next(layout_bitmap bits, size_t from)
+{
+    size_t count = bits.bitCount;
+    if (from >= count) return count;
+
+    size_t bytes = (count + 7) / 8;
+    size_t byte = from / 8;
+    unsigned value = bits.bits[byte] & (0xffu << (from % 8));
+    while (!value) {
+        byte++;
+        // Skip a word of zero bytes at a time.
+        // bits.bits is malloc'd, so aligned bytes are aligned words.
+        while (byte % sizeof(uintptr_t) == 0  &&  
+               byte + sizeof(uintptr_t) <= bytes  &&  
+               *(uintptr_t *)(bits.bits + byte) == 0)
+        {
+            byte += sizeof(uintptr_t);
+        }
+        if (byte >= bytes) return count;
+        value = bits.bits[byte];
+    }
+
+    size_t bit = byte * 8 + __builtin_ctz(value);
+    return bit < count ? bit : count;
 }
 
 
@@ -37,6 +37,7 @@ extern void add_class_to_loadable_list(Class cls);
 extern void add_category_to_loadable_list(Category cat);
 extern void remove_class_from_loadable_list(Class cls);
 extern void remove_category_from_loadable_list(Category cat);
+extern void remove_image_from_load_records(const struct header_info *hi);
 
 extern void call_load_methods(void);
 
@@ -31,17 +31,35 @@
 
 typedef void(*load_method_t)(id, SEL);
 
+// Per-image +load record, kept when PrintLoading is set. 
+// Records are never moved. They are freed when their image is unmapped.
+struct load_image {
+    uint64_t duration;      // nanoseconds in +load since last reported
+    int32_t classCount;     // class +loads since last reported
+    int32_t categoryCount;  // category +loads since last reported
+    const header_info *hi;  // may be nil
+    const char *name;       // may be nil
+    struct load_image *next;
+};
+
 struct loadable_class {
     Class cls;  // may be nil
     IMP method;
+    struct load_image *image;  // may be nil
 };
 
 struct loadable_category {
     Category cat;  // may be nil
     IMP method;
+    struct load_image *image;  // may be nil
 };
 
 
+// List of per-image +load records, in order of creation
+static struct load_image *load_image_records = nil;
+static struct load_image **load_image_records_tail = &load_image_records;
+
+
 // List of classes that need +load called (pending superclass +load)
 // This list always has superclasses first because of the way it is constructed
 static struct loadable_class *loadable_classes = nil;
@@ -54,6 +72,96 @@ static int loadable_categories_used = 0;
 static int loadable_categories_allocated = 0;
 
 
+/***********************************************************************
+* load_image_for
+* Returns the +load record for the image containing addr, 
+* creating it if necessary.
+* Returns nil unless PrintLoading is set.
+**********************************************************************/
+static struct load_image *load_image_for(void *addr)
+{
+    loadMethodLock.assertLocked();
+
+    if (!PrintLoading) return nil;
+
+    const header_info *hi = _headerForAddress(addr);
+
+    struct load_image *image;
+    for (image = load_image_records; image; image = image->next) {
+        if (image->hi == hi) return image;
+    }
+
+    image = (struct load_image *)calloc(1, sizeof(struct load_image));
+    image->hi = hi;
+    image->name = hi ? hi->fname() : nil;
+    *load_image_records_tail = image;
+    load_image_records_tail = &image->next;
+    return image;
+}
+
+
+/***********************************************************************
+* remove_image_from_load_records
+* Image hi is being unmapped. Free its +load record, if any, so that 
+* its name is not used after the unmap and a later image with the same 
+* header_info address gets a new record.
+**********************************************************************/
+void remove_image_from_load_records(const header_info *hi)
+{
+    loadMethodLock.assertLocked();
+
+    struct load_image **link = &load_image_records;
+    while (*link  &&  (*link)->hi != hi) link = &(*link)->next;
+
+    struct load_image *image = *link;
+    if (!image) return;
+
+    // The image's loadable entries were already unscheduled, 
+    // but they still point at the record.
+    int i;
+    for (i = 0; i < loadable_classes_used; i++) {
+        if (loadable_classes[i].image == image) {
+            loadable_classes[i].image = nil;
+        }
+    }
+    for (i = 0; i < loadable_categories_used; i++) {
+        if (loadable_categories[i].image == image) {
+            loadable_categories[i].image = nil;
+        }
+    }
+
+    *link = image->next;
+    if (load_image_records_tail == &image->next) {
+        load_image_records_tail = link;
+    }
+    free(image);
+}
+
+
+/***********************************************************************
+* report_load_image_times
+* Log each image's +load time since the last report.
+**********************************************************************/
+static void report_load_image_times(void)
+{
+    loadMethodLock.assertLocked();
+
+    if (!PrintLoading) return;
+
+    struct load_image *image;
+    for (image = load_image_records; image; image = image->next) {
+        if (image->classCount == 0  &&  image->categoryCount == 0) continue;
+        _objc_inform("LOAD: %.3f ms in %d class and %d category +load "
+                     "methods of %s", image->duration / 1000000.0, 
+                     image->classCount, image->categoryCount, 
+                     image->name ? image->name : "(unknown image)");
+        image->duration = 0;
+        image->classCount = 0;
+        image->categoryCount = 0;
+    }
+}
+
+
 /***********************************************************************
 * add_class_to_loadable_list
 * Class cls has just become connected. Schedule it for +load if
@@ -83,6 +191,7 @@ void add_class_to_loadable_list(Class cls)
     
     loadable_classes[loadable_classes_used].cls = cls;
     loadable_classes[loadable_classes_used].method = method;
+    loadable_classes[loadable_classes_used].image = load_image_for(cls);
     loadable_classes_used++;
 }
 
@@ -119,6 +228,7 @@ void add_category_to_loadable_list(Category cat)
 
     loadable_categories[loadable_categories_used].cat = cat;
     loadable_categories[loadable_categories_used].method = method;
+    loadable_categories[loadable_categories_used].image = load_image_for(cat);
     loadable_categories_used++;
 }
 
@@ -174,6 +284,38 @@ void remove_category_from_loadable_list(Category cat)
 }
 
 
+/***********************************************************************
+* call_load_method
+* Call one +load method, timing it for OBJC_PRINT_LOAD_METHODS.
+**********************************************************************/
+static void call_load_method(load_method_t load_method, Class cls, 
+                             struct load_image *image, bool category)
+{
+    if (!PrintLoading  ||  !image) {
+        (*load_method)(cls, SEL_load);
+        return;
+    }
+
+    uint64_t start = nanoseconds();
+    (*load_method)(cls, SEL_load);
+    image->duration += nanoseconds() - start;
+    if (category) image->categoryCount++;
+    else image->classCount++;
+}
+
+
+static void call_class_load(struct loadable_class *lc)
+{
+    Class cls = lc->cls;
+    if (!cls) return;
+
+    if (PrintLoading) {
+        _objc_inform("LOAD: +[%s load]\n", cls->nameForLogging());
+    }
+    call_load_method((load_method_t)lc->method, cls, lc->image, false);
+}
+
+
 /***********************************************************************
 * call_class_loads
 * Call all pending class +load methods.
@@ -194,14 +336,7 @@ static void call_class_loads(void)
     
     // Call all +loads for the detached list.
     for (i = 0; i < used; i++) {
-        Class cls = classes[i].cls;
-        load_method_t load_method = (load_method_t)classes[i].method;
-        if (!cls) continue; 
-
-        if (PrintLoading) {
-            _objc_inform("LOAD: +[%s load]\n", cls->nameForLogging());
-        }
-        (*load_method)(cls, SEL_load);
+        call_class_load(&classes[i]);
     }
     
     // Destroy the detached list.
@@ -248,7 +383,7 @@ static bool call_category_loads(void)
                              cls->nameForLogging(), 
                              _category_getName(cat));
             }
-            (*load_method)(cls, SEL_load);
+            call_load_method(load_method, cls, cats[i].image, true);
             cats[i].cat = nil;
         }
     }
@@ -361,6 +496,8 @@ void call_load_methods(void)
 
     objc_autoreleasePoolPop(pool);
 
+    report_load_image_times();
+
     loading = NO;
 }
 
@@ -42,9 +42,11 @@ extern recursive_mutex_t loadMethodLock;
 extern mutex_t crashlog_lock;
 extern spinlock_t objcMsgLogLock;
 extern mutex_t AltHandlerDebugLock;
-extern mutex_t AssociationsManagerLock;
+extern mutex_t SlabLock;
+extern mutex_t MethodSignatureLock;
+extern StripedMap<spinlock_t> AssociationsManagerLocks;
 extern StripedMap<spinlock_t> PropertyLocks;
-extern StripedMap<spinlock_t> StructLocks;
+extern StripedMap<seqlock_t> StructLocks;
 extern StripedMap<spinlock_t> CppObjectLocks;
 
 // SideTable lock is buried awkwardly. Call a function to manipulate it.
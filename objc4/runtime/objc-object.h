@@ -423,10 +423,10 @@ objc_object::rootDealloc()
                  !isa.has_sidetable_rc))
     {
         assert(!sidetable_present());
-        free(this);
+        object_free(this);
     } 
     else {
-        object_dispose((id)this);
+        _objc_disposeOrDefer((id)this);
     }
 }
 
@@ -867,7 +867,7 @@ inline void
 objc_object::rootDealloc()
 {
     if (isTaggedPointer()) return;
-    object_dispose((id)this);
+    _objc_disposeOrDefer((id)this);
 }
 
 
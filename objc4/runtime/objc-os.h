@@ -260,6 +260,7 @@ ClearExclusive(uintptr_t *dst __unused)
 #       include <vector>
 #       include <algorithm>
 #       include <functional>
+#       include <atomic>
         using namespace std;
 #   endif
 
@@ -785,12 +786,14 @@ static inline pthread_priority_t pthread_self_priority_direct()
 
 
 template <bool Debug> class mutex_tt;
+template <bool Debug> class seqlock_tt;
 template <bool Debug> class monitor_tt;
 template <bool Debug> class rwlock_tt;
 template <bool Debug> class recursive_mutex_tt;
 
 using spinlock_t = mutex_tt<DEBUG>;
 using mutex_t = mutex_tt<DEBUG>;
+using seqlock_t = seqlock_tt<DEBUG>;
 using monitor_t = monitor_tt<DEBUG>;
 using rwlock_t = rwlock_tt<DEBUG>;
 using recursive_mutex_t = recursive_mutex_tt<DEBUG>;
@@ -820,6 +823,13 @@ class mutex_tt : nocopy_t {
             (&mLock, OS_UNFAIR_LOCK_DATA_SYNCHRONIZATION);
     }
 
+    bool tryLock() {
+        if (!os_unfair_lock_trylock(&mLock)) return false;
+
+        lockdebug_mutex_lock(this);
+        return true;
+    }
+
     void unlock() {
         lockdebug_mutex_unlock(this);
 
@@ -861,6 +871,84 @@ class mutex_tt : nocopy_t {
 };
 
 
+// seqlock_tt is a mutex for writers plus a sequence number for readers.
+// The sequence number is odd while a writer holds the lock.
+// Readers copy the protected data without locking, then retry 
+// if a writer was active meanwhile:
+//     uint32_t seq;
+//     do {
+//         seq = lock.readBegin();
+//         ... copy the data ...
+//     } while (lock.readRetry(seq));
+// The copy may be torn before a retry, so readers must only copy 
+// plain bytes, never act on them.
+template <bool Debug>
+class seqlock_tt : nocopy_t {
+    // mLock must be first. Lock debugging identifies 
+    // the seqlock and its mutex by the same address.
+    mutex_tt<Debug> mLock;
+    volatile uint32_t mSequence;
+
+ public:
+    seqlock_tt() : mLock(), mSequence(0) { }
+
+    void lock() {
+        mLock.lock();
+        mSequence++;
+        atomic_thread_fence(memory_order_release);
+    }
+
+    void unlock() {
+        atomic_thread_fence(memory_order_release);
+        mSequence++;
+        mLock.unlock();
+    }
+
+    void forceReset() {
+        mLock.forceReset();
+        if (mSequence & 1) mSequence++;
+    }
+
+    void assertLocked() {
+        mLock.assertLocked();
+    }
+
+    void assertUnlocked() {
+        mLock.assertUnlocked();
+    }
+
+    uint32_t readBegin() {
+        uint32_t seq = mSequence;
+        atomic_thread_fence(memory_order_acquire);
+        return seq;
+    }
+
+    // Returns true if a writer was active since readBegin() returned seq.
+    bool readRetry(uint32_t seq) {
+        atomic_thread_fence(memory_order_acquire);
+        return (seq & 1)  ||  seq != mSequence;
+    }
+
+
+    // Address-ordered lock discipline for a pair of locks.
+
+    static void lockTwo(seqlock_tt *lock1, seqlock_tt *lock2) {
+        if (lock1 < lock2) {
+            lock1->lock();
+            lock2->lock();
+        } else {
+            lock2->lock();
+            if (lock2 != lock1) lock1->lock(); 
+        }
+    }
+
+    static void unlockTwo(seqlock_tt *lock1, seqlock_tt *lock2) {
+        lock1->unlock();
+        if (lock2 != lock1) lock2->unlock();
+    }
+};
+
+
 template <bool Debug>
 class recursive_mutex_tt : nocopy_t {
     pthread_mutex_t mLock;
@@ -898,6 +986,19 @@ class recursive_mutex_tt : nocopy_t {
         mLock = pthread_mutex_t PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
     }
 
+    bool tryLock()
+    {
+        int err = pthread_mutex_trylock(&mLock);
+        if (err == 0) {
+            lockdebug_recursive_mutex_lock(this);
+            return true;
+        } else if (err == EBUSY) {
+            return false;
+        } else {
+            _objc_fatal("pthread_mutex_trylock failed (%d)", err);
+        }
+    }
+
     bool tryUnlock()
     {
         int err = pthread_mutex_unlock(&mLock);
@@ -582,6 +582,7 @@ unmap_image_nolock(const struct mach_header *mh)
     }
 
     _unload_image(hi);
+    remove_image_from_load_records(hi);
 
     // Remove header_info from header list
     removeHeader(hi);
@@ -639,7 +640,9 @@ static void defineLockOrder()
     lockdebug_lock_precedes_lock(&cacheUpdateLock, &crashlog_lock);
     lockdebug_lock_precedes_lock(&objcMsgLogLock, &crashlog_lock);
     lockdebug_lock_precedes_lock(&AltHandlerDebugLock, &crashlog_lock);
-    lockdebug_lock_precedes_lock(&AssociationsManagerLock, &crashlog_lock);
+    lockdebug_lock_precedes_lock(&SlabLock, &crashlog_lock);
+    lockdebug_lock_precedes_lock(&MethodSignatureLock, &crashlog_lock);
+    AssociationsManagerLocks.precedeLock(&crashlog_lock);
     SideTableLocksPrecedeLock(&crashlog_lock);
     PropertyLocks.precedeLock(&crashlog_lock);
     StructLocks.precedeLock(&crashlog_lock);
@@ -661,7 +664,9 @@ static void defineLockOrder()
     lockdebug_lock_precedes_lock(&loadMethodLock, &cacheUpdateLock);
     lockdebug_lock_precedes_lock(&loadMethodLock, &objcMsgLogLock);
     lockdebug_lock_precedes_lock(&loadMethodLock, &AltHandlerDebugLock);
-    lockdebug_lock_precedes_lock(&loadMethodLock, &AssociationsManagerLock);
+    lockdebug_lock_precedes_lock(&loadMethodLock, &SlabLock);
+    lockdebug_lock_precedes_lock(&loadMethodLock, &MethodSignatureLock);
+    AssociationsManagerLocks.succeedLock(&loadMethodLock);
     SideTableLocksSucceedLock(&loadMethodLock);
     PropertyLocks.succeedLock(&loadMethodLock);
     StructLocks.succeedLock(&loadMethodLock);
@@ -695,8 +700,12 @@ static void defineLockOrder()
     CppObjectLocks.precedeLock(&objcMsgLogLock);
     PropertyLocks.precedeLock(&AltHandlerDebugLock);
     CppObjectLocks.precedeLock(&AltHandlerDebugLock);
-    PropertyLocks.precedeLock(&AssociationsManagerLock);
-    CppObjectLocks.precedeLock(&AssociationsManagerLock);
+    PropertyLocks.precedeLocks(AssociationsManagerLocks);
+    CppObjectLocks.precedeLocks(AssociationsManagerLocks);
+    PropertyLocks.precedeLock(&SlabLock);
+    CppObjectLocks.precedeLock(&SlabLock);
+    PropertyLocks.precedeLock(&MethodSignatureLock);
+    CppObjectLocks.precedeLock(&MethodSignatureLock);
     // fixme side table
     
 #if __OBJC2__
@@ -707,6 +716,8 @@ static void defineLockOrder()
     // Runtime operations may occur inside SideTable locks
     // (such as storeWeak calling getMethodImplementation)
     SideTableLocksPrecedeLock(&runtimeLock);
+    // Objects may be freed inside runtimeLock.
+    lockdebug_lock_precedes_lock(&runtimeLock, &SlabLock);
     // Some operations may occur inside runtimeLock.
     lockdebug_lock_precedes_lock(&runtimeLock, &selLock);
     lockdebug_lock_precedes_lock(&runtimeLock, &cacheUpdateLock);
@@ -726,6 +737,7 @@ static void defineLockOrder()
 
     // Striped locks use address order internally.
     SideTableDefineLockOrder();
+    AssociationsManagerLocks.defineLockOrder();
     PropertyLocks.defineLockOrder();
     StructLocks.defineLockOrder();
     CppObjectLocks.defineLockOrder();
@@ -756,7 +768,9 @@ void _objc_atfork_prepare()
     cacheUpdateLock.lock();
     objcMsgLogLock.lock();
     AltHandlerDebugLock.lock();
-    AssociationsManagerLock.lock();
+    SlabLock.lock();
+    MethodSignatureLock.lock();
+    AssociationsManagerLocks.lockAll();
     StructLocks.lockAll();
     crashlog_lock.lock();
 
@@ -771,8 +785,10 @@ void _objc_atfork_parent()
     CppObjectLocks.unlockAll();
     StructLocks.unlockAll();
     PropertyLocks.unlockAll();
-    AssociationsManagerLock.unlock();
+    AssociationsManagerLocks.unlockAll();
     AltHandlerDebugLock.unlock();
+    SlabLock.unlock();
+    MethodSignatureLock.unlock();
     objcMsgLogLock.unlock();
     crashlog_lock.unlock();
     loadMethodLock.unlock();
@@ -800,8 +816,10 @@ void _objc_atfork_child()
     CppObjectLocks.forceResetAll();
     StructLocks.forceResetAll();
     PropertyLocks.forceResetAll();
-    AssociationsManagerLock.forceReset();
+    AssociationsManagerLocks.forceResetAll();
     AltHandlerDebugLock.forceReset();
+    SlabLock.forceReset();
+    MethodSignatureLock.forceReset();
     objcMsgLogLock.forceReset();
     crashlog_lock.forceReset();
     loadMethodLock.forceReset();
@@ -838,6 +856,7 @@ void _objc_init(void)
     // fixme defer initialization until an objc-using image is found?
     environ_init();
     tls_init();
+    SideTableInit();
     static_init();
     lock_init();
     exception_init();
@@ -850,7 +869,7 @@ void _objc_init(void)
 * _headerForAddress.
 * addr can be a class or a category
 **********************************************************************/
-static const header_info *_headerForAddress(void *addr)
+const header_info *_headerForAddress(void *addr)
 {
 #if __OBJC2__
     const char *segnames[] = { "__DATA", "__DATA_CONST", "__DATA_DIRTY" };
@@ -227,6 +227,13 @@ public:
     void clearDeallocating();
     void rootDealloc();
 
+    // Side-table-only retain count for batched retain/release.
+    // The caller holds table's lock.
+    // sidetable_release_nolock() returns true if the object should
+    // now be deallocated, but does not call -dealloc.
+    void sidetable_retain_nolock(SideTable& table);
+    bool sidetable_release_nolock(SideTable& table);
+
 private:
     void initIsa(Class newCls, bool nonpointer, bool hasCxxDtor);
 
@@ -506,6 +513,7 @@ static inline bool sectnameStartsWith(const char *sectname, const char *prefix){
 /* selectors */
 extern void sel_init(size_t selrefCount);
 extern SEL sel_registerNameNoLock(const char *str, bool copy);
+extern bool sel_addImageSeloptNoLock(const struct objc_image_selopt_t *table, size_t tableSize, const char *imageName);
 extern void sel_lock(void);
 extern void sel_unlock(void);
 
@@ -664,6 +672,9 @@ typedef struct {
     struct SyncCache *syncCache;  // for @synchronize
     struct alt_handler_list *handlerList;  // for exception alt handlers
     char *printableNames[4];  // temporary demangled names for logging
+    struct AutoreleasePoolPageCache *poolPageCache;  // for autorelease pools
+    int deferDeallocMode;  // for deferred dealloc
+    struct SlabCache *slabCache;  // for slab allocation
 
     // If you add new fields here, don't forget to update 
     // _objc_pthread_destroyspecific()
@@ -681,17 +692,48 @@ extern void encoding_getReturnType(const char *t, char *dst, size_t dst_len);
 extern char * encoding_copyReturnType(const char *t);
 extern void encoding_getArgumentType(const char *t, unsigned int index, char *dst, size_t dst_len);
 extern char *encoding_copyArgumentType(const char *t, unsigned int index);
+extern void encoding_getArgumentLayout(const char *t, unsigned int index, size_t *size, size_t *alignment);
 
 // sync.h
 extern void _destroySyncCache(struct SyncCache *cache);
 
+// arr
+extern void _destroyAutoreleasePoolPageCache(struct AutoreleasePoolPageCache *cache);
+
+// slab allocation
+extern void _destroySlabCache(struct SlabCache *cache);
+extern void *slab_calloc(size_t size);
+extern void slab_free(void *ptr);
+extern uintptr_t SlabRegionStart;
+extern uintptr_t SlabRegionEnd;
+
+// Locking: none. SlabRegionEnd is published after SlabRegionStart.
+static inline bool slab_owns(const void *ptr)
+{
+    uintptr_t p = (uintptr_t)ptr;
+    uintptr_t end = __atomic_load_n(&SlabRegionEnd, __ATOMIC_ACQUIRE);
+    return p < end  &&  p >= SlabRegionStart;
+}
+
+// Free an object's memory, which may have come from the slab.
+static inline void object_free(void *obj)
+{
+    if (slowpath(slab_owns(obj))) slab_free(obj);
+    else free(obj);
+}
+
 // arr
 extern void arr_init(void);
+extern void SideTableInit(void);
 extern id objc_autoreleaseReturnValue(id obj);
 
 // block trampolines
 extern IMP _imp_implementationWithBlockNoCopy(id block);
 
+// deferred dealloc
+extern void _objc_disposeOrDefer(id obj);
+extern void _objc_enableDeferredDealloc(void);
+
 // layout.h
 typedef struct {
     uint8_t *bits;
@@ -712,6 +754,10 @@ extern bool layout_bitmap_splat(layout_bitmap dst, layout_bitmap src,
 extern bool layout_bitmap_or(layout_bitmap dst, layout_bitmap src, const char *msg);
 extern bool layout_bitmap_clear(layout_bitmap dst, layout_bitmap src, const char *msg);
 extern void layout_bitmap_print(layout_bitmap bits);
+extern size_t layout_bitmap_next(layout_bitmap bits, size_t from);
+#if __OBJC2__
+extern layout_bitmap _class_getIvarLayoutBitmap(Class cls, bool weak);
+#endif
 
 
 // fixme runtime
@@ -729,6 +775,7 @@ extern const char ** _objc_copyClassNamesForImage(header_info *hi, unsigned int
 
 
 extern const header_info *_headerForClass(Class cls);
+extern const header_info *_headerForAddress(void *addr);
 
 extern Class _class_remap(Class cls);
 extern Class _class_getNonMetaClass(Class cls, id obj);
@@ -920,6 +967,12 @@ class StripedMap {
         // assumes defineLockOrder is also called
         lockdebug_lock_precedes_lock(oldlock, &array[0].value);
     }
+
+    template <typename U>
+    void precedeLocks(StripedMap<U>& other) {
+        // assumes defineLockOrder is also called on both maps
+        other.succeedLock(&array[StripeCount-1].value);
+    }
     
 #if DEBUG
     StripedMap() {
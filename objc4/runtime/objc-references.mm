@@ -165,16 +165,93 @@ namespace objc_references_support {
         bool hasValue() { return _value != nil; }
     };
 
-#if TARGET_OS_WIN32
-    typedef hash_map<void *, ObjcAssociation> ObjectAssociationMap;
-    typedef hash_map<disguised_ptr_t, ObjectAssociationMap *> AssociationsHashMap;
-#else
     typedef ObjcAllocator<std::pair<void * const, ObjcAssociation> > ObjectAssociationMapAllocator;
-    class ObjectAssociationMap : public std::map<void *, ObjcAssociation, ObjectPointerLess, ObjectAssociationMapAllocator> {
+    class OverflowAssociationMap : public std::map<void *, ObjcAssociation, ObjectPointerLess, ObjectAssociationMapAllocator> {
     public:
         void *operator new(size_t n) { return ::malloc(n); }
         void operator delete(void *ptr) { ::free(ptr); }
     };
+
+    // The associations of a single object.
+    // Most objects have only a few associations. The first InlineCount 
+    // are stored in small inline arrays; the rest spill into a std::map.
+    class ObjectAssociationMap {
+        enum { InlineCount = 4 };
+
+        void *_keys[InlineCount];
+        ObjcAssociation _values[InlineCount];
+        unsigned _count;
+        OverflowAssociationMap *_overflow;
+
+    public:
+        ObjectAssociationMap() : _count(0), _overflow(nil) {}
+        ~ObjectAssociationMap() { delete _overflow; }
+
+        void *operator new(size_t n) { return ::malloc(n); }
+        void operator delete(void *ptr) { ::free(ptr); }
+
+        ObjcAssociation *find(void *key) {
+            for (unsigned i = 0; i < _count; i++) {
+                if (_keys[i] == key) return &_values[i];
+            }
+            if (_overflow) {
+                OverflowAssociationMap::iterator j = _overflow->find(key);
+                if (j != _overflow->end()) return &j->second;
+            }
+            return nil;
+        }
+
+        // key must not already be present.
+        void insert(void *key, const ObjcAssociation &association) {
+            if (_count < InlineCount) {
+                _keys[_count] = key;
+                _values[_count] = association;
+                _count++;
+                return;
+            }
+            if (!_overflow) _overflow = new OverflowAssociationMap;
+            (*_overflow)[key] = association;
+        }
+
+        // Returns the removed association, or an empty one if key is absent.
+        ObjcAssociation remove(void *key) {
+            ObjcAssociation old_association;
+            for (unsigned i = 0; i < _count; i++) {
+                if (_keys[i] == key) {
+                    old_association = _values[i];
+                    // Move the last inline entry into the hole.
+                    _count--;
+                    _keys[i] = _keys[_count];
+                    _values[i] = _values[_count];
+                    return old_association;
+                }
+            }
+            if (_overflow) {
+                OverflowAssociationMap::iterator j = _overflow->find(key);
+                if (j != _overflow->end()) {
+                    old_association = j->second;
+                    _overflow->erase(j);
+                }
+            }
+            return old_association;
+        }
+
+        template <typename Fn>
+        void forEach(Fn fn) {
+            for (unsigned i = 0; i < _count; i++) {
+                fn(_values[i]);
+            }
+            if (_overflow) {
+                for (OverflowAssociationMap::iterator j = _overflow->begin(), end = _overflow->end(); j != end; ++j) {
+                    fn(j->second);
+                }
+            }
+        }
+    };
+
+#if TARGET_OS_WIN32
+    typedef hash_map<disguised_ptr_t, ObjectAssociationMap *> AssociationsHashMap;
+#else
     typedef ObjcAllocator<std::pair<const disguised_ptr_t, ObjectAssociationMap*> > AssociationsHashMapAllocator;
     class AssociationsHashMap : public unordered_map<disguised_ptr_t, ObjectAssociationMap *, DisguisedPointerHash, DisguisedPointerEqual, AssociationsHashMapAllocator> {
     public:
@@ -186,18 +263,30 @@ namespace objc_references_support {
 
 using namespace objc_references_support;
 
-// class AssociationsManager manages a lock / hash table singleton pair.
-// Allocating an instance acquires the lock, and calling its assocations()
-// method lazily allocates the hash table.
+// class AssociationsManager manages a lock / hash table pair.
+// Associations are striped by object address across several 
+// lock / hash table pairs so threads working on unrelated objects 
+// do not contend. Allocating an instance acquires the object's stripe 
+// lock, and calling its assocations() method lazily allocates that 
+// stripe's hash table.
+
+StripedMap<spinlock_t> AssociationsManagerLocks;
 
-spinlock_t AssociationsManagerLock;
+// associative references: object pointer -> PtrPtrHashMap.
+// Indexed identically to AssociationsManagerLocks.
+static StripedMap<AssociationsHashMap *> AssociationsHashMaps;
 
 class AssociationsManager {
-    // associative references: object pointer -> PtrPtrHashMap.
-    static AssociationsHashMap *_map;
+    spinlock_t &_lock;
+    AssociationsHashMap *&_map;
 public:
-    AssociationsManager()   { AssociationsManagerLock.lock(); }
-    ~AssociationsManager()  { AssociationsManagerLock.unlock(); }
+    AssociationsManager(id object)
+        : _lock(AssociationsManagerLocks[object]), 
+          _map(AssociationsHashMaps[object])
+    {
+        _lock.lock(); 
+    }
+    ~AssociationsManager()  { _lock.unlock(); }
     
     AssociationsHashMap &associations() {
         if (_map == NULL)
@@ -206,8 +295,6 @@ public:
     }
 };
 
-AssociationsHashMap *AssociationsManager::_map = NULL;
-
 // expanded policy bits.
 
 enum { 
@@ -223,17 +310,16 @@ id _object_get_associative_reference(id object, void *key) {
     id value = nil;
     uintptr_t policy = OBJC_ASSOCIATION_ASSIGN;
     {
-        AssociationsManager manager;
+        AssociationsManager manager(object);
         AssociationsHashMap &associations(manager.associations());
         disguised_ptr_t disguised_object = DISGUISE(object);
         AssociationsHashMap::iterator i = associations.find(disguised_object);
         if (i != associations.end()) {
             ObjectAssociationMap *refs = i->second;
-            ObjectAssociationMap::iterator j = refs->find(key);
-            if (j != refs->end()) {
-                ObjcAssociation &entry = j->second;
-                value = entry.value();
-                policy = entry.policy();
+            ObjcAssociation *entry = refs->find(key);
+            if (entry) {
+                value = entry->value();
+                policy = entry->policy();
                 if (policy & OBJC_ASSOCIATION_GETTER_RETAIN) ((id(*)(id, SEL))objc_msgSend)(value, SEL_retain);
             }
         }
@@ -271,7 +357,7 @@ void _object_set_associative_reference(id object, void *key, id value, uintptr_t
     ObjcAssociation old_association(0, nil);
     id new_value = value ? acquireValue(value, policy) : nil;
     {
-        AssociationsManager manager;
+        AssociationsManager manager(object);
         AssociationsHashMap &associations(manager.associations());
         disguised_ptr_t disguised_object = DISGUISE(object);
         if (new_value) {
@@ -280,18 +366,18 @@ void _object_set_associative_reference(id object, void *key, id value, uintptr_t
             if (i != associations.end()) {
                 // secondary table exists
                 ObjectAssociationMap *refs = i->second;
-                ObjectAssociationMap::iterator j = refs->find(key);
-                if (j != refs->end()) {
-                    old_association = j->second;
-                    j->second = ObjcAssociation(policy, new_value);
+                ObjcAssociation *entry = refs->find(key);
+                if (entry) {
+                    old_association = *entry;
+                    *entry = ObjcAssociation(policy, new_value);
                 } else {
-                    (*refs)[key] = ObjcAssociation(policy, new_value);
+                    refs->insert(key, ObjcAssociation(policy, new_value));
                 }
             } else {
                 // create the new association (first time).
                 ObjectAssociationMap *refs = new ObjectAssociationMap;
                 associations[disguised_object] = refs;
-                (*refs)[key] = ObjcAssociation(policy, new_value);
+                refs->insert(key, ObjcAssociation(policy, new_value));
                 object->setHasAssociatedObjects();
             }
         } else {
@@ -299,11 +385,7 @@ void _object_set_associative_reference(id object, void *key, id value, uintptr_t
             AssociationsHashMap::iterator i = associations.find(disguised_object);
             if (i !=  associations.end()) {
                 ObjectAssociationMap *refs = i->second;
-                ObjectAssociationMap::iterator j = refs->find(key);
-                if (j != refs->end()) {
-                    old_association = j->second;
-                    refs->erase(j);
-                }
+                old_association = refs->remove(key);
             }
         }
     }
@@ -314,7 +396,7 @@ void _object_set_associative_reference(id object, void *key, id value, uintptr_t
 void _object_remove_assocations(id object) {
     vector< ObjcAssociation,ObjcAllocator<ObjcAssociation> > elements;
     {
-        AssociationsManager manager;
+        AssociationsManager manager(object);
         AssociationsHashMap &associations(manager.associations());
         if (associations.size() == 0) return;
         disguised_ptr_t disguised_object = DISGUISE(object);
@@ -322,9 +404,9 @@ void _object_remove_assocations(id object) {
         if (i != associations.end()) {
             // copy all of the associations that need to be removed.
             ObjectAssociationMap *refs = i->second;
-            for (ObjectAssociationMap::iterator j = refs->begin(), end = refs->end(); j != end; ++j) {
-                elements.push_back(j->second);
-            }
+            refs->forEach([&](ObjcAssociation &association) {
+                elements.push_back(association);
+            });
             // remove the secondary table.
             delete refs;
             associations.erase(i);
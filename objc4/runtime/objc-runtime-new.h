@@ -420,8 +420,8 @@ struct locstamped_category_list_t {
 #define RW_CONSTRUCTING       (1<<26)
 // class allocated and registered
 #define RW_CONSTRUCTED        (1<<25)
-// available for use; was RW_FINALIZE_ON_MAIN_THREAD
-// #define RW_24 (1<<24)
+// class's base method list is not yet fixed up (OBJC_LAZY_METHOD_LIST_FIXUP)
+#define RW_LAZY_METHODS       (1<<24)
 // class +load has been called
 #define RW_LOADED             (1<<23)
 #if !SUPPORT_NONPOINTER_ISA
@@ -430,10 +430,14 @@ struct locstamped_category_list_t {
 #endif
 // class has instance-specific GC layout
 #define RW_HAS_INSTANCE_SPECIFIC_LAYOUT (1 << 21)
-// available for use
-// #define RW_20       (1<<20)
+// class or superclass tears down instances on the deferred dealloc queue
+#define RW_DEFERS_DEALLOC     (1<<20)
 // class has started realizing but not yet completed it
 #define RW_REALIZING          (1<<19)
+// class or superclass allocates small instances from the slab
+#define RW_USES_SLAB          (1<<14)
+// class or superclass zero-fills only the object ivars of large instances
+#define RW_SKIPS_ZERO_FILL    (1<<13)
 
 // NOTE: MORE RW_ FLAGS DEFINED BELOW
 
@@ -798,6 +802,34 @@ class protocol_array_t :
 };
 
 
+struct method_filter_t;
+struct zero_fill_map_t;
+struct ivar_layout_bitmaps_t;
+
+// Per-class data used only by opt-in or occasional features. 
+// Allocated on first use, so most classes never pay for it. 
+// See class_rw_t::extra().
+struct class_rw_extra_t {
+    // Negative lookup filter for forwarding-heavy classes.
+    // See lookUpImpOrForward().
+    method_filter_t *methodFilter;
+    uint32_t forwardCount;
+
+    // Method cache sizing history. See cache_erase_nolock().
+    mask_t cachePeakOccupied;      // peak since the last flush
+    mask_t cachePrevPeakOccupied;  // peak in the flush interval before that
+    mask_t cacheShrinkCapacity;    // capacity before a pending shrink, or 0
+    uint32_t cacheShrinkEpoch;
+
+    // Words of a new instance that must be zeroed when the class 
+    // skips zero-fill. Built on first use. See instance_alloc().
+    zero_fill_map_t *zeroFillMap;
+
+    // Decompressed ARC ivar layouts. Built on first use. 
+    // See _class_getIvarLayoutBitmap().
+    ivar_layout_bitmaps_t *ivarLayoutBitmaps;
+};
+
 struct class_rw_t {
     // Be warned that Symbolication knows the layout of this structure.
     uint32_t flags;
@@ -818,6 +850,22 @@ struct class_rw_t {
     uint32_t index;
 #endif
 
+    // Nil until first use. See class_rw_extra_t.
+    class_rw_extra_t *extraData;
+
+    // Returns nil if nothing has needed the extra data yet.
+    class_rw_extra_t *extraIfExists() const {
+        return extraData;
+    }
+
+    class_rw_extra_t *extra() {
+        class_rw_extra_t *e = extraData;
+        if (fastpath(e)) return e;
+        return allocateExtra();
+    }
+
+    class_rw_extra_t *allocateExtra();
+
     void setFlags(uint32_t set) 
     {
         OSAtomicOr32Barrier(set, &flags);
@@ -1145,6 +1193,39 @@ struct objc_class : objc_object {
         bits.setHasCxxDtor();
     }
 
+    bool defersDealloc() {
+        // addSubclass() propagates this flag from the superclass.
+        return data()->flags & RW_DEFERS_DEALLOC;
+    }
+    void setDefersDealloc() {
+        setInfo(RW_DEFERS_DEALLOC);
+    }
+    void clearDefersDealloc() {
+        clearInfo(RW_DEFERS_DEALLOC);
+    }
+
+    bool usesSlab() {
+        // addSubclass() propagates this flag from the superclass.
+        return data()->flags & RW_USES_SLAB;
+    }
+    void setUsesSlab() {
+        setInfo(RW_USES_SLAB);
+    }
+    void clearUsesSlab() {
+        clearInfo(RW_USES_SLAB);
+    }
+
+    bool skipsZeroFill() {
+        // addSubclass() propagates this flag from the superclass.
+        return data()->flags & RW_SKIPS_ZERO_FILL;
+    }
+    void setSkipsZeroFill() {
+        setInfo(RW_SKIPS_ZERO_FILL);
+    }
+    void clearSkipsZeroFill() {
+        clearInfo(RW_SKIPS_ZERO_FILL);
+    }
+
 
     bool isSwift() {
         return bits.isSwift();
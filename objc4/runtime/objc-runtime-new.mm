@@ -53,6 +53,11 @@ static bool methodListImplementsAWZ(const method_list_t *mlist);
 static void updateCustomRR_AWZ(Class cls, method_t *meth);
 static method_t *search_method_list(const method_list_t *mlist, SEL sel);
 static void flushCaches(Class cls);
+static void method_filter_erase(Class cls);
+static void zero_fill_map_erase(Class cls);
+static void ivar_layout_bitmaps_erase(Class cls);
+static void fixupLazyMethodLists(Class cls);
+static void fixupLazyMethodListsForReading(Class cls, bool withSuperclasses);
 #if SUPPORT_FIXUP
 static void fixupMessageRef(message_ref_t *msg);
 #endif
@@ -482,6 +487,8 @@ static void printReplacements(Class cls, category_list *cats)
 
     if (!cats) return;
 
+    fixupLazyMethodLists(cls);
+
     // Newest categories are LAST in cats
     // Later categories override earlier ones.
     for (c = 0; c < cats->count; c++) {
@@ -612,6 +619,59 @@ prepareMethodLists(Class cls, method_list_t **addedLists, int addedCount,
 }
 
 
+/***********************************************************************
+* fixupLazyMethodLists
+* Fixes up cls's base method list if methodizeClass deferred it.
+* With OBJC_LAZY_METHOD_LIST_FIXUP, a class's base method list stays 
+* un-uniqued and unsorted until something searches or returns 
+* its methods. Every such path calls this first, so no method_t from 
+* an unfixed list escapes and the list is never re-sorted under a 
+* caller's Method.
+* Locking: runtimeLock must be write-locked by the caller
+**********************************************************************/
+static void fixupLazyMethodLists(Class cls)
+{
+    runtimeLock.assertWriting();
+
+    auto rw = cls->data();
+    if (!(rw->flags & RW_LAZY_METHODS)) return;
+
+    method_list_t *mlist = rw->ro->baseMethods();
+    if (mlist  &&  !mlist->isFixedUp()) {
+        fixupMethodList(mlist, isBundleClass(cls), true/*sort*/);
+    }
+    rw->clearFlags(RW_LAZY_METHODS);
+}
+
+
+/***********************************************************************
+* fixupLazyMethodListsForReading
+* Like fixupLazyMethodLists, for callers holding runtimeLock for reading.
+* Also fixes up the superclasses if withSuperclasses is set.
+* The read lock is dropped while the write lock is held, 
+* but only if some class needs fixing up.
+* Locking: runtimeLock must be read-locked by the caller
+**********************************************************************/
+static void fixupLazyMethodListsForReading(Class cls, bool withSuperclasses)
+{
+    runtimeLock.assertReading();
+
+    Class c;
+    for (c = cls; c; c = withSuperclasses ? c->superclass : nil) {
+        if (c->data()->flags & RW_LAZY_METHODS) break;
+    }
+    if (!c) return;
+
+    runtimeLock.unlockRead();
+    runtimeLock.write();
+    for (c = cls; c; c = withSuperclasses ? c->superclass : nil) {
+        fixupLazyMethodLists(c);
+    }
+    runtimeLock.unlockWrite();
+    runtimeLock.read();
+}
+
+
 // Attach method lists and properties and protocols from categories to a class.
 // Assumes the categories in cats are all loaded and sorted by load order, 
 // oldest categories first.
@@ -694,9 +754,16 @@ static void methodizeClass(Class cls)
     }
 
     // Install methods and properties that the class implements itself.
+    // Root metaclasses get methods added below, which needs a fixed list.
     method_list_t *list = ro->baseMethods();
     if (list) {
-        prepareMethodLists(cls, &list, 1, YES, isBundleClass(cls));
+        if (LazyMethodListFixup  &&  !list->isFixedUp()  &&  
+            !cls->isRootMetaclass()) 
+        {
+            rw->setFlags(RW_LAZY_METHODS);
+        } else {
+            prepareMethodLists(cls, &list, 1, YES, isBundleClass(cls));
+        }
         rw->methods.attachLists(&list, 1);
     }
 
@@ -735,12 +802,14 @@ static void methodizeClass(Class cls)
 
 #if DEBUG
     // Debug: sanity-check all SELs; log method list contents
+    // Lazily fixed-up base methods are not uniqued yet.
     for (const auto& meth : rw->methods) {
         if (PrintConnecting) {
             _objc_inform("METHOD %c[%s %s]", isMeta ? '+' : '-', 
                          cls->nameForLogging(), sel_getName(meth.name));
         }
-        assert(sel_registerName(sel_getName(meth.name)) == meth.name); 
+        assert((rw->flags & RW_LAZY_METHODS)  ||  
+               sel_registerName(sel_getName(meth.name)) == meth.name); 
     }
 #endif
 }
@@ -1449,6 +1518,18 @@ static void addSubclass(Class supercls, Class subcls)
         if (supercls->instancesRequireRawIsa()  &&  supercls->superclass) {
             subcls->setInstancesRequireRawIsa(true);
         }
+
+        if (supercls->defersDealloc()) {
+            subcls->setDefersDealloc();
+        }
+
+        if (supercls->usesSlab()) {
+            subcls->setUsesSlab();
+        }
+
+        if (supercls->skipsZeroFill()) {
+            subcls->setSkipsZeroFill();
+        }
     }
 }
 
@@ -1967,18 +2048,25 @@ static void flushCaches(Class cls)
 {
     runtimeLock.assertWriting();
 
-    mutex_locker_t lock(cacheUpdateLock);
+    {
+        mutex_locker_t lock(cacheUpdateLock);
 
-    if (cls) {
-        foreach_realized_class_and_subclass(cls, ^(Class c){
-            cache_erase_nolock(c);
-        });
-    }
-    else {
-        foreach_realized_class_and_metaclass(^(Class c){
-            cache_erase_nolock(c);
-        });
+        if (cls) {
+            foreach_realized_class_and_subclass(cls, ^(Class c){
+                cache_erase_nolock(c);
+                method_filter_erase(c);
+            });
+        }
+        else {
+            foreach_realized_class_and_metaclass(^(Class c){
+                cache_erase_nolock(c);
+                method_filter_erase(c);
+            });
+        }
     }
+
+    // Free the erased buckets without blocking cache fills.
+    cache_collect_unlocked();
 }
 
 
@@ -2447,6 +2535,17 @@ void _read_images(header_info **hList, uint32_t hCount, int totalClasses, int un
     for (EACH_HEADER) {
         if (hi->isPreoptimized()) continue;
 
+        // Adopt the image's precomputed selector table, if any.
+        // Bundles may be unloaded, taking the table's strings with them.
+        if (!hi->isBundle()) {
+            size_t seloptSize;
+            objc_image_selopt_t *selopt = 
+                _getObjc2ImageSelopt(hi, &seloptSize);
+            if (selopt) {
+                sel_addImageSeloptNoLock(selopt, seloptSize, hi->fname());
+            }
+        }
+
         bool isBundle = hi->isBundle();
         SEL *sels = _getObjc2SelectorRefs(hi, &count);
         UnfixedSelectors += count;
@@ -3952,6 +4051,8 @@ class_copyMethodList(Class cls, unsigned int *outCount)
     
     assert(cls->isRealized());
 
+    fixupLazyMethodListsForReading(cls, NO);
+
     count = cls->data()->methods.count();
 
     if (count > 0) {
@@ -4386,35 +4487,40 @@ class_setVersion(Class cls, int version)
 }
 
 
+/***********************************************************************
+* findMethodInSortedMethodList
+* Returns the first method in list whose name is key, or nil.
+* The search narrows the list with a branch-free lower bound, 
+* then scans the last few entries in order. Both halves avoid the 
+* mispredicted compare of a classic binary search, and the final 
+* scan touches adjacent methods that usually share a cache line.
+* Locking: none
+**********************************************************************/
+#define METHOD_LIST_LINEAR_SEARCH_COUNT 8
+
 static method_t *findMethodInSortedMethodList(SEL key, const method_list_t *list)
 {
     assert(list);
 
-    const method_t * const first = &list->first;
-    const method_t *base = first;
-    const method_t *probe;
+    const method_t *base = &list->first;
+    const method_t * const end = base + list->count;
     uintptr_t keyValue = (uintptr_t)key;
-    uint32_t count;
-    
-    for (count = list->count; count != 0; count >>= 1) {
-        probe = base + (count >> 1);
-        
+    uint32_t count = list->count;
+
+    // The first method whose name is >= key lies in [base, base+count].
+    while (count > METHOD_LIST_LINEAR_SEARCH_COUNT) {
+        uint32_t half = count >> 1;
+        base = ((uintptr_t)base[half].name < keyValue) ? base + half : base;
+        count -= half;
+    }
+
+    // Every method before base is less than key, so the first match 
+    // found here is the first occurrence, as category overrides require.
+    for (const method_t *probe = base; probe <= base + count; probe++) {
+        if (probe == end) break;
         uintptr_t probeValue = (uintptr_t)probe->name;
-        
-        if (keyValue == probeValue) {
-            // `probe` is a match.
-            // Rewind looking for the *first* occurrence of this value.
-            // This is required for correct category overrides.
-            while (probe > first && keyValue == (uintptr_t)probe[-1].name) {
-                probe--;
-            }
-            return (method_t *)probe;
-        }
-        
-        if (keyValue > probeValue) {
-            base = probe + 1;
-            count--;
-        }
+        if (probeValue == keyValue) return (method_t *)probe;
+        if (probeValue > keyValue) break;
     }
     
     return nil;
@@ -4459,6 +4565,7 @@ getMethodNoSuper_nolock(Class cls, SEL sel)
     runtimeLock.assertLocked();
 
     assert(cls->isRealized());
+    assert(!(cls->data()->flags & RW_LAZY_METHODS));
     // fixme nil cls? 
     // fixme nil sel?
 
@@ -4508,6 +4615,7 @@ getMethod_nolock(Class cls, SEL sel)
 static Method _class_getMethod(Class cls, SEL sel)
 {
     rwlock_reader_t lock(runtimeLock);
+    fixupLazyMethodListsForReading(cls, YES);
     return getMethod_nolock(cls, sel);
 }
 
@@ -4559,6 +4667,140 @@ log_and_fill_cache(Class cls, IMP imp, SEL sel, id receiver, Class implementer)
 }
 
 
+/***********************************************************************
+* class_rw_t::allocateExtra
+* Installs zero-filled extra data for a class that has none.
+* Locking: none. Racing allocators keep the first one installed.
+* The extra data is freed only with the class itself.
+**********************************************************************/
+class_rw_extra_t *class_rw_t::allocateExtra()
+{
+    class_rw_extra_t *e = (class_rw_extra_t *)calloc(sizeof(*e), 1);
+    if (!OSAtomicCompareAndSwapPtrBarrier(nil, e, 
+                                          (void * volatile *)&extraData))
+    {
+        free(e);
+        e = extraData;
+    }
+    return e;
+}
+
+
+/***********************************************************************
+* method_filter_t
+* A bloom filter of every selector implemented by a class and its 
+* superclasses. A class that keeps falling through to forwarding gets 
+* one, so a selector the hierarchy cannot implement is rejected with 
+* one probe instead of a search of every method list.
+* The filter is built under runtimeLock for reading and published 
+* with compare-and-swap. It is freed by flushCaches(), which holds 
+* runtimeLock for writing, so the filter is valid whenever the 
+* method lists and superclass chain it was built from are.
+**********************************************************************/
+// Full misses before a class gets a filter.
+#define METHOD_FILTER_FORWARD_THRESHOLD 16
+// Filter bits per selector. 16 bits and 3 probes is about 0.1% false hits.
+#define METHOD_FILTER_BITS_PER_METHOD 16
+#define METHOD_FILTER_MAX_BITS (1 << 21)
+
+struct method_filter_t {
+    uint32_t mask;  // bit count - 1; bit count is a power of 2
+
+    uint64_t *bits() const {
+        return (uint64_t *)(this + 1);
+    }
+
+    static uint64_t hash(SEL sel) {
+        return (uint64_t)(uintptr_t)sel * 0x9e3779b97f4a7c15ULL;
+    }
+
+    void add(SEL sel) {
+        uint64_t h = hash(sel);
+        for (unsigned i = 0; i < 3; i++, h >>= 21) {
+            uint32_t bit = (uint32_t)h & mask;
+            bits()[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+
+    bool mayContain(SEL sel) const {
+        uint64_t h = hash(sel);
+        for (unsigned i = 0; i < 3; i++, h >>= 21) {
+            uint32_t bit = (uint32_t)h & mask;
+            if (!(bits()[bit / 64] & (1ULL << (bit % 64)))) return false;
+        }
+        return true;
+    }
+};
+
+
+/***********************************************************************
+* method_filter_build
+* Builds and installs a filter for cls if it has none.
+* Locking: runtimeLock must be held by the caller
+**********************************************************************/
+static void method_filter_build(Class cls)
+{
+    runtimeLock.assertLocked();
+    assert(cls->isRealized());
+
+    auto extra = cls->data()->extra();
+    if (extra->methodFilter) return;
+
+    size_t methodCount = 0;
+    for (Class c = cls; c; c = c->superclass) {
+        assert(!(c->data()->flags & RW_LAZY_METHODS));
+        for (auto mlists = c->data()->methods.beginLists(), 
+                  end = c->data()->methods.endLists(); 
+             mlists != end;
+             ++mlists)
+        {
+            methodCount += (*mlists)->count;
+        }
+    }
+
+    uint32_t bitCount = 64;
+    while (bitCount < methodCount * METHOD_FILTER_BITS_PER_METHOD  &&  
+           bitCount < METHOD_FILTER_MAX_BITS) 
+    {
+        bitCount *= 2;
+    }
+
+    method_filter_t *filter = (method_filter_t *)
+        calloc(1, sizeof(method_filter_t) + bitCount / 8);
+    filter->mask = bitCount - 1;
+    for (Class c = cls; c; c = c->superclass) {
+        for (auto& meth : c->data()->methods) {
+            filter->add(meth.name);
+        }
+    }
+
+    if (!OSAtomicCompareAndSwapPtrBarrier(nil, filter, 
+                                          (void * volatile *)&extra->methodFilter))
+    {
+        // Another thread installed a filter first.
+        free(filter);
+    }
+}
+
+
+/***********************************************************************
+* method_filter_erase
+* Discards cls's filter. It is rebuilt after more full misses.
+* Locking: runtimeLock must be write-locked by the caller
+**********************************************************************/
+static void method_filter_erase(Class cls)
+{
+    runtimeLock.assertWriting();
+
+    auto extra = cls->data()->extraIfExists();
+    if (!extra) return;
+
+    free(extra->methodFilter);
+    extra->methodFilter = nil;
+    extra->forwardCount = 0;
+}
+
+
 /***********************************************************************
 * _class_lookupMethodAndLoadCache.
 * Method lookup for dispatchers ONLY. OTHER CODE SHOULD USE lookUpImp().
@@ -4632,6 +4874,8 @@ IMP lookUpImpOrForward(Class cls, SEL sel, id inst,
         // from the messenger then it won't happen. 2778172
     }
 
+    fixupLazyMethodListsForReading(cls, YES);
+
     
  retry:    
     runtimeLock.assertReading();
@@ -4641,6 +4885,13 @@ IMP lookUpImpOrForward(Class cls, SEL sel, id inst,
     imp = cache_getImp(cls, sel);
     if (imp) goto done;
 
+    // Skip the hierarchy search if the class's filter rules sel out.
+    {
+        auto extra = cls->data()->extraIfExists();
+        method_filter_t *filter = extra ? extra->methodFilter : nil;
+        if (filter  &&  !filter->mayContain(sel)) goto notFound;
+    }
+
     // Try this class's method lists.
     {
         Method meth = getMethodNoSuper_nolock(cls, sel);
@@ -4691,6 +4942,7 @@ IMP lookUpImpOrForward(Class cls, SEL sel, id inst,
 
     // No implementation found. Try method resolver once.
 
+ notFound:
     if (resolver  &&  !triedResolver) {
         runtimeLock.unlockRead();
         _class_resolveMethod(cls, sel, inst);
@@ -4704,6 +4956,16 @@ IMP lookUpImpOrForward(Class cls, SEL sel, id inst,
     // No implementation found, and method resolver didn't help. 
     // Use forwarding.
 
+    {
+        auto extra = cls->data()->extra();
+        if (!extra->methodFilter  &&  
+            OSAtomicIncrement32((volatile int32_t *)&extra->forwardCount) 
+            == METHOD_FILTER_FORWARD_THRESHOLD)
+        {
+            method_filter_build(cls);
+        }
+    }
+
     imp = (IMP)_objc_msgForward_impcache;
     cache_fill(cls, sel, imp, inst);
 
@@ -4749,6 +5011,8 @@ IMP lookupMethodInClassAndLoadCache(Class cls, SEL sel)
 
     rwlock_reader_t lock(runtimeLock);
 
+    fixupLazyMethodListsForReading(cls, NO);
+
     meth = getMethodNoSuper_nolock(cls, sel);
 
     if (meth) {
@@ -4823,6 +5087,9 @@ objc_class::setInitialized()
 
     rwlock_reader_t lock(runtimeLock);
 
+    fixupLazyMethodListsForReading(cls, NO);
+    fixupLazyMethodListsForReading(metacls, NO);
+
     // Scan metaclass for custom AWZ.
     // Scan metaclass for custom RR.
     // Scan class for custom RR.
@@ -5215,6 +5482,87 @@ updateCustomRR_AWZ(Class cls, method_t *meth)
 }
 
 
+/***********************************************************************
+* _class_getIvarLayoutBitmap
+* Returns cls's own strong or weak ARC ivar layout as a bitmap. 
+* Bit 0 is the word at cls->alignedInstanceStart(). A nil layout 
+* gives an empty bitmap. Both layouts are decompressed on first use 
+* and cached; do not free the result.
+* Returns a bitmap with nil bits if the layout can't be cached because 
+* the class is under construction or has instance-specific layout. 
+* The class must be realized.
+* Locking: none
+**********************************************************************/
+struct ivar_layout_bitmaps_t {
+    layout_bitmap strong;
+    layout_bitmap weak;
+};
+
+static layout_bitmap ivar_layout_bitmap_create(const uint8_t *layout, 
+                                               size_t span, bool weak)
+{
+    if (!layout) return layout_bitmap_create_empty(span, weak);
+
+    // Layouts from class_setIvarLayout() may run past the ivars.
+    size_t bitCount = 0;
+    for (const uint8_t *p = layout; *p; p++) {
+        bitCount += (*p >> 4) + (*p & 0x0f);
+    }
+    size_t size = MAX(span, bitCount * sizeof(id));
+    return layout_bitmap_create(layout, size, size, weak);
+}
+
+layout_bitmap
+_class_getIvarLayoutBitmap(Class cls, bool weak)
+{
+    assert(cls->isRealized());
+
+    class_rw_t *rw = cls->data();
+    if (rw->flags & (RW_CONSTRUCTING | RW_HAS_INSTANCE_SPECIFIC_LAYOUT)) {
+        layout_bitmap none = {nil, 0, 0, weak};
+        return none;
+    }
+
+    class_rw_extra_t *extra = rw->extra();
+    ivar_layout_bitmaps_t *bitmaps = extra->ivarLayoutBitmaps;
+    if (slowpath(!bitmaps)) {
+        size_t span = 
+            word_align(cls->unalignedInstanceSize()) - cls->alignedInstanceStart();
+        bitmaps = (ivar_layout_bitmaps_t *)malloc(sizeof(*bitmaps));
+        bitmaps->strong = ivar_layout_bitmap_create(rw->ro->ivarLayout, span, NO);
+        bitmaps->weak = 
+            ivar_layout_bitmap_create(rw->ro->weakIvarLayout, span, YES);
+
+        if (!OSAtomicCompareAndSwapPtrBarrier(nil, bitmaps, 
+                               (void * volatile *)&extra->ivarLayoutBitmaps))
+        {
+            layout_bitmap_free(bitmaps->strong);
+            layout_bitmap_free(bitmaps->weak);
+            free(bitmaps);
+            bitmaps = extra->ivarLayoutBitmaps;
+        }
+    }
+
+    return weak ? bitmaps->weak : bitmaps->strong;
+}
+
+
+// Locking: runtimeLock must be held by the caller.
+static void ivar_layout_bitmaps_erase(Class cls)
+{
+    runtimeLock.assertWriting();
+
+    class_rw_extra_t *extra = cls->data()->extraIfExists();
+    if (!extra  ||  !extra->ivarLayoutBitmaps) return;
+
+    ivar_layout_bitmaps_t *bitmaps = extra->ivarLayoutBitmaps;
+    layout_bitmap_free(bitmaps->strong);
+    layout_bitmap_free(bitmaps->weak);
+    free(bitmaps);
+    extra->ivarLayoutBitmaps = nil;
+}
+
+
 /***********************************************************************
 * class_getIvarLayout
 * Called by the garbage collector. 
@@ -5446,6 +5794,8 @@ addMethod(Class cls, SEL name, IMP imp, const char *types, bool replace)
     assert(types);
     assert(cls->isRealized());
 
+    fixupLazyMethodLists(cls);
+
     method_t *m;
     if ((m = getMethodNoSuper_nolock(cls, name))) {
         // already exists
@@ -5704,6 +6054,8 @@ objc_duplicateClass(Class original, const char *name,
     assert(original->isRealized());
     assert(!original->isMetaClass());
 
+    fixupLazyMethodLists(original);
+
     duplicate = alloc_class_for_subclass(original, extraBytes);
 
     duplicate->initClassIsa(original->ISA());
@@ -6022,6 +6374,10 @@ static void free_class(Class cls)
     auto ro = rw->ro;
 
     cache_delete(cls);
+    method_filter_erase(cls);
+    zero_fill_map_erase(cls);
+    ivar_layout_bitmaps_erase(cls);
+    free(rw->extraIfExists());
     
     for (auto& meth : rw->methods) {
         try_free(meth.types);
@@ -6139,6 +6495,188 @@ objc_constructInstance(Class cls, void *bytes)
 * Locking: none
 **********************************************************************/
 
+/***********************************************************************
+* Partial zero-fill
+* Classes that opted in with objc_setClassSkipsZeroFill() get their 
+* large instances from malloc() instead of calloc(). Only the words 
+* that the runtime and ARC need to start out zero are cleared:
+* - every ivar of a class that is not ARC, because nothing describes 
+*   which of its ivars hold objects
+* - strong and weak ivars of an ARC class, from its ivar layouts
+* - extra bytes past the class's instance size
+* The remaining ivars of ARC classes start with garbage. The class's 
+* initializers must set them before anything reads them.
+**********************************************************************/
+
+// Smaller instances are zero-filled whole. calloc() is as cheap as 
+// targeted zeroing for them.
+#define ZERO_FILL_MIN_SIZE 256
+
+struct zero_fill_run_t {
+    uint32_t offset;  // in bytes
+    uint32_t length;  // in bytes
+};
+
+struct zero_fill_map_t {
+    uint32_t instanceSize;  // everything from here on is zeroed
+    uint32_t runCount;
+    zero_fill_run_t runs[0];
+};
+
+// Map for classes whose instances are zero-filled whole.
+static zero_fill_map_t ZeroFillAll;
+
+
+static inline void zero_fill_set(layout_bitmap words, size_t word)
+{
+    words.bits[word/8] |= 1 << (word % 8);
+}
+
+static inline bool zero_fill_test(layout_bitmap words, size_t word)
+{
+    return words.bits[word/8] & (1 << (word % 8));
+}
+
+
+// Mark the words of an ARC ivar layout bitmap, which starts at word start.
+static void zero_fill_mark_layout(layout_bitmap words, layout_bitmap layout,
+                                  size_t start)
+{
+    for (size_t i = layout_bitmap_next(layout, 0); 
+         i < layout.bitCount  &&  start + i < words.bitCount; 
+         i = layout_bitmap_next(layout, i+1))
+    {
+        zero_fill_set(words, start + i);
+    }
+}
+
+
+/***********************************************************************
+* zero_fill_map_create
+* Builds the list of byte ranges that a new instance of cls 
+* must have zeroed. Returns &ZeroFillAll if most of the instance 
+* would be zeroed anyway or if its layout is not known.
+* Locking: none. The ivar layouts of a realized class do not change.
+**********************************************************************/
+static zero_fill_map_t *zero_fill_map_create(Class cls)
+{
+    if (cls->isSwift()) return &ZeroFillAll;
+
+    size_t size = cls->alignedInstanceSize();
+    layout_bitmap words = layout_bitmap_create_empty(size, NO);
+
+    for (Class c = cls; c; c = c->superclass) {
+        size_t end = word_align(c->unalignedInstanceSize()) / sizeof(id);
+        layout_bitmap strong = {nil, 0, 0, NO};
+        layout_bitmap weak = {nil, 0, 0, YES};
+        if (c->isARC()) {
+            strong = _class_getIvarLayoutBitmap(c, NO);
+            weak = _class_getIvarLayoutBitmap(c, YES);
+        }
+
+        if (strong.bits  &&  weak.bits) {
+            size_t start = c->alignedInstanceStart() / sizeof(id);
+            zero_fill_mark_layout(words, strong, start);
+            zero_fill_mark_layout(words, weak, start);
+        }
+        else {
+            // Includes the word shared with the superclass's last ivars.
+            size_t start = c->unalignedInstanceStart() / sizeof(id);
+            for (size_t w = start; w < end; w++) zero_fill_set(words, w);
+        }
+    }
+
+    size_t zeroWords = 0;
+    uint32_t runCount = 0;
+    for (size_t w = 0; w < words.bitCount; w++) {
+        if (!zero_fill_test(words, w)) continue;
+        zeroWords++;
+        if (w == 0  ||  !zero_fill_test(words, w-1)) runCount++;
+    }
+
+    zero_fill_map_t *map = &ZeroFillAll;
+    if (zeroWords * 2 <= words.bitCount) {
+        map = (zero_fill_map_t *)
+            calloc(sizeof(zero_fill_map_t) + 
+                   runCount * sizeof(zero_fill_run_t), 1);
+        map->instanceSize = (uint32_t)size;
+        for (size_t w = 0; w < words.bitCount; w++) {
+            if (!zero_fill_test(words, w)) continue;
+            if (w == 0  ||  !zero_fill_test(words, w-1)) {
+                map->runs[map->runCount++].offset = 
+                    (uint32_t)(w * sizeof(id));
+            }
+            map->runs[map->runCount-1].length += sizeof(id);
+        }
+    }
+
+    layout_bitmap_free(words);
+    return map;
+}
+
+
+// Returns cls's zero-fill map, building it on first use.
+// Locking: none. Racing builders keep the first map installed.
+static zero_fill_map_t *zero_fill_map_for(Class cls)
+{
+    class_rw_extra_t *extra = cls->data()->extra();
+    zero_fill_map_t *map = extra->zeroFillMap;
+    if (fastpath(map)) return map;
+
+    map = zero_fill_map_create(cls);
+    if (!OSAtomicCompareAndSwapPtrBarrier(nil, map, 
+                                          (void * volatile *)&extra->zeroFillMap))
+    {
+        if (map != &ZeroFillAll) free(map);
+        map = extra->zeroFillMap;
+    }
+    return map;
+}
+
+
+// Locking: runtimeLock must be held by the caller.
+static void zero_fill_map_erase(Class cls)
+{
+    runtimeLock.assertWriting();
+
+    class_rw_extra_t *extra = cls->data()->extraIfExists();
+    if (!extra) return;
+
+    if (extra->zeroFillMap != &ZeroFillAll) free(extra->zeroFillMap);
+    extra->zeroFillMap = nil;
+}
+
+
+// Allocate memory for an instance of cls, ready for initIsa() 
+// and C++ construction.
+// Classes that opted in with objc_setClassUsesSlab() try the slab first.
+// Classes that opted in with objc_setClassSkipsZeroFill() may 
+// get memory that is only partly zeroed. See zero_fill_map_create().
+static inline void *
+instance_alloc(Class cls, size_t size)
+{
+    if (slowpath(cls->usesSlab())) {
+        void *bytes = slab_calloc(size);
+        if (bytes) return bytes;
+    }
+    if (slowpath(cls->skipsZeroFill())  &&  size >= ZERO_FILL_MIN_SIZE) {
+        zero_fill_map_t *map = zero_fill_map_for(cls);
+        if (map != &ZeroFillAll) {
+            uint8_t *bytes = (uint8_t *)malloc(size);
+            if (!bytes) return nil;
+            for (uint32_t i = 0; i < map->runCount; i++) {
+                bzero(bytes + map->runs[i].offset, map->runs[i].length);
+            }
+            if (size > map->instanceSize) {
+                bzero(bytes + map->instanceSize, size - map->instanceSize);
+            }
+            return bytes;
+        }
+    }
+    return calloc(1, size);
+}
+
+
 static __attribute__((always_inline)) 
 id
 _class_createInstanceFromZone(Class cls, size_t extraBytes, void *zone, 
@@ -6159,7 +6697,7 @@ _class_createInstanceFromZone(Class cls, size_t extraBytes, void *zone,
 
     id obj;
     if (!zone  &&  fast) {
-        obj = (id)calloc(1, size);
+        obj = (id)instance_alloc(cls, size);
         if (!obj) return nil;
         obj->initInstanceIsa(cls, hasCxxDtor);
     } 
@@ -6167,7 +6705,7 @@ _class_createInstanceFromZone(Class cls, size_t extraBytes, void *zone,
         if (zone) {
             obj = (id)malloc_zone_calloc ((malloc_zone_t *)zone, 1, size);
         } else {
-            obj = (id)calloc(1, size);
+            obj = (id)instance_alloc(cls, size);
         }
         if (!obj) return nil;
 
@@ -6301,6 +6839,71 @@ void *objc_destructInstance(id obj)
 }
 
 
+/***********************************************************************
+* objc_setClassDefersDealloc
+* Sets whether instances of cls and its subclasses hand their teardown 
+* to the deferred dealloc queue. See _objc_disposeOrDefer().
+* Locking: acquires runtimeLock
+**********************************************************************/
+void 
+objc_setClassDefersDealloc(Class cls, BOOL defer)
+{
+    if (!cls) return;
+
+    if (defer) _objc_enableDeferredDealloc();
+
+    rwlock_writer_t lock(runtimeLock);
+
+    realizeClass(cls);
+    foreach_realized_class_and_subclass(cls, ^(Class c){
+        if (defer) c->setDefersDealloc();
+        else c->clearDefersDealloc();
+    });
+}
+
+
+/***********************************************************************
+* objc_setClassUsesSlab
+* Sets whether instances of cls and its subclasses are allocated 
+* from the slab. Instances already allocated keep their memory.
+* Locking: acquires runtimeLock
+**********************************************************************/
+void 
+objc_setClassUsesSlab(Class cls, BOOL useSlab)
+{
+    if (!cls) return;
+
+    rwlock_writer_t lock(runtimeLock);
+
+    realizeClass(cls);
+    foreach_realized_class_and_subclass(cls, ^(Class c){
+        if (useSlab) c->setUsesSlab();
+        else c->clearUsesSlab();
+    });
+}
+
+
+/***********************************************************************
+* objc_setClassSkipsZeroFill
+* Sets whether large instances of cls and its subclasses are zeroed 
+* only where ARC and the runtime require it. See instance_alloc().
+* Locking: acquires runtimeLock
+**********************************************************************/
+void 
+objc_setClassSkipsZeroFill(Class cls, BOOL skip)
+{
+    if (!cls) return;
+
+    rwlock_writer_t lock(runtimeLock);
+
+    realizeClass(cls);
+    foreach_realized_class_and_subclass(cls, ^(Class c){
+        if (skip) c->setSkipsZeroFill();
+        else c->clearSkipsZeroFill();
+    });
+}
+
+
 /***********************************************************************
 * object_dispose
 * fixme
@@ -6312,7 +6915,7 @@ object_dispose(id obj)
     if (!obj) return nil;
 
     objc_destructInstance(obj);    
-    free(obj);
+    object_free(obj);
 
     return nil;
 }
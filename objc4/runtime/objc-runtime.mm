@@ -389,6 +389,8 @@ void _objc_pthread_destroyspecific(void *arg)
     if (data != NULL) {
         _destroyInitializingClassList(data->initializingClasses);
         _destroySyncCache(data->syncCache);
+        _destroyAutoreleasePoolPageCache(data->poolPageCache);
+        _destroySlabCache(data->slabCache);
         _destroyAltHandlerList(data->handlerList);
         for (int i = 0; i < (int)countof(data->printableNames); i++) {
             if (data->printableNames[i]) {
@@ -25,6 +25,7 @@
 
 #include "objc-private.h"
 #include "objc-cache.h"
+#include "objc-selopt.h"
 
 #if SUPPORT_PREOPT
 static const objc_selopt_t *builtins = NULL;
@@ -35,7 +36,13 @@ static size_t SelrefCount = 0;
 
 static NXMapTable *namedSelectors;
 
+// Precomputed selector tables from non-bundle images, in adoption order.
+// Those images are never unloaded, so the tables stay valid.
+static const objc_image_selopt_t **imageSelopts;
+static unsigned imageSeloptCount;
+
 static SEL search_builtins(const char *key);
+static SEL search_image_selopts(const char *key);
 
 
 /***********************************************************************
@@ -120,10 +127,10 @@ BOOL sel_isMapped(SEL sel)
     if (sel == search_builtins(name)) return YES;
 
     rwlock_reader_t lock(selLock);
-    if (namedSelectors) {
-        return (sel == (SEL)NXMapGet(namedSelectors, name));
-    }
-    return false;
+    SEL result = nil;
+    if (namedSelectors) result = (SEL)NXMapGet(namedSelectors, name);
+    if (!result) result = search_image_selopts(name);
+    return (sel == result);
 }
 
 
@@ -136,6 +143,76 @@ static SEL search_builtins(const char *name)
 }
 
 
+/***********************************************************************
+* search_image_selopts
+* Returns the SEL for name from the first adopted image table that 
+* contains it, or nil.
+* Locking: selLock must be held
+**********************************************************************/
+static SEL search_image_selopts(const char *name)
+{
+    if (imageSeloptCount == 0) return nil;
+
+    uint64_t base = objc_image_selopt_t::baseHash(name);
+    for (unsigned i = 0; i < imageSeloptCount; i++) {
+        const char *result = imageSelopts[i]->get(name, base);
+        if (result) return (SEL)result;
+    }
+    return nil;
+}
+
+
+/***********************************************************************
+* sel_addImageSeloptNoLock
+* Adopt an image's precomputed selector table. The table's names are 
+* not copied or inserted into namedSelectors; __sel_registerName and 
+* sel_isMapped look them up in the table instead.
+* namedSelectors is searched before the tables, so a name that was 
+* registered before this table was adopted keeps its existing SEL. 
+* A name that only tables contain resolves to the first adopted 
+* table's string, and is never inserted into namedSelectors.
+* The table is ignored if its version is unknown or it does not fit 
+* in its section. The image must never be unloaded.
+* tableSize is the section size in bytes.
+* Returns true if the table was adopted.
+* Locking: selLock must be held for writing
+**********************************************************************/
+bool sel_addImageSeloptNoLock(const objc_image_selopt_t *table, 
+                              size_t tableSize, const char *imageName)
+{
+    selLock.assertWriting();
+
+    if (tableSize < sizeof(*table)  ||  
+        table->version != OBJC_IMAGE_SELOPT_VERSION)
+    {
+        if (PrintPreopt) {
+            _objc_inform("PREOPTIMIZATION: ignoring selector table with "
+                         "unknown version in %s", imageName);
+        }
+        return false;
+    }
+
+    if (!table->isValid(tableSize)) {
+        if (PrintPreopt) {
+            _objc_inform("PREOPTIMIZATION: ignoring malformed selector "
+                         "table in %s", imageName);
+        }
+        return false;
+    }
+
+    // Readers hold selLock for reading, so the array can move here.
+    imageSelopts = (const objc_image_selopt_t **)
+        realloc(imageSelopts, (imageSeloptCount+1) * sizeof(table));
+    imageSelopts[imageSeloptCount++] = table;
+
+    if (PrintPreopt) {
+        _objc_inform("PREOPTIMIZATION: using %u precomputed selectors "
+                     "from %s", table->count, imageName);
+    }
+    return true;
+}
+
+
 static SEL __sel_registerName(const char *name, int lock, int copy) 
 {
     SEL result = 0;
@@ -152,6 +229,7 @@ static SEL __sel_registerName(const char *name, int lock, int copy)
     if (namedSelectors) {
         result = (SEL)NXMapGet(namedSelectors, name);
     }
+    if (!result) result = search_image_selopts(name);
     if (lock) selLock.unlockRead();
     if (result) return result;
 
@@ -166,6 +244,7 @@ static SEL __sel_registerName(const char *name, int lock, int copy)
     if (lock) {
         // Rescan in case it was added while we dropped the lock
         result = (SEL)NXMapGet(namedSelectors, name);
+        if (!result) result = search_image_selopts(name);
     }
     if (!result) {
         result = sel_alloc(name, copy);
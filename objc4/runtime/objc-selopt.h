@@ -0,0 +1,153 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  objc-selopt.h
+  Per-image precomputed selector tables.
+
+  The selopt tool builds a perfect hash table of an image's selector
+  names and emits it as a __DATA,__objc_selopt section. The runtime
+  keeps every adopted table and looks names up in them before it
+  inserts a new name into namedSelectors. A name found in a table
+  uses the table's string as its SEL, so it is never copied or
+  inserted.
+
+  This header is shared by the runtime and the selopt tool.
+  Keep it free of runtime dependencies.
+
+  Table layout (all offsets are from the start of the header):
+    objc_image_selopt_t header
+    int32_t displacements[displacementMask+1]
+    int32_t offsets[mask+1]    offset of a NUL-terminated name, or 0
+    char    strings[]
+*/
+
+#ifndef _OBJC_SELOPT_H
+#define _OBJC_SELOPT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define OBJC_IMAGE_SELOPT_VERSION 2
+
+struct objc_image_selopt_t {
+    uint32_t version;
+    uint32_t count;             // number of selector names
+    uint32_t mask;              // slot count - 1; slot count is a power of 2
+    uint32_t displacementMask;  // displacement count - 1; a power of 2 - 1
+    uint64_t salt;
+
+    // FNV-1a. It does not depend on the table, so a lookup that
+    // probes several tables hashes the key once.
+    static uint64_t baseHash(const char *key) {
+        uint64_t h = 14695981039346656037ULL;
+        for (const uint8_t *s = (const uint8_t *)key; *s; s++) {
+            h ^= *s;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    // Mixes in the table's salt with a 64-bit finalizer.
+    static uint64_t hash(uint64_t base, uint64_t salt) {
+        uint64_t h = base ^ salt;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static uint32_t bucketForHash(uint64_t h, uint32_t displacementMask) {
+        return (uint32_t)(h >> 32) & displacementMask;
+    }
+
+    static uint32_t slotForHash(uint64_t h, int32_t displacement,
+                                uint32_t mask) {
+        return ((uint32_t)h ^ (uint32_t)displacement) & mask;
+    }
+
+    const int32_t *displacements() const {
+        return (const int32_t *)(this + 1);
+    }
+
+    const int32_t *offsets() const {
+        return displacements() + displacementMask + 1;
+    }
+
+    size_t headerAndIndexSize() const {
+        return sizeof(*this)
+            + (displacementMask + 1 + mask + 1) * sizeof(int32_t);
+    }
+
+    // Returns true if the index and every name lie within size bytes.
+    // Check this before calling nameAtSlot() on an untrusted table.
+    bool isValid(size_t size) const {
+        if (size < sizeof(*this)) return false;
+        if ((mask & (mask + 1))  ||  
+            (displacementMask & (displacementMask + 1)))
+        {
+            return false;
+        }
+        if (mask >= (1U << 28)  ||  displacementMask >= (1U << 28)) {
+            return false;
+        }
+        if (headerAndIndexSize() > size  ||  count > (uint64_t)mask + 1) {
+            return false;
+        }
+        const int32_t *offs = offsets();
+        for (uint32_t slot = 0; slot <= mask; slot++) {
+            int32_t offset = offs[slot];
+            if (offset == 0) continue;
+            if (offset < 0  ||  (size_t)offset < headerAndIndexSize()  ||  
+                (size_t)offset >= size)
+            {
+                return false;
+            }
+            const char *name = (const char *)this + offset;
+            if (!memchr(name, 0, size - offset)) return false;
+        }
+        return true;
+    }
+
+    const char *nameAtSlot(uint32_t slot) const {
+        int32_t offset = offsets()[slot];
+        if (offset == 0) return nullptr;
+        return (const char *)this + offset;
+    }
+
+    // Returns this table's copy of key, or nullptr if key is absent.
+    // base is baseHash(key).
+    const char *get(const char *key, uint64_t base) const {
+        uint64_t h = hash(base, salt);
+        int32_t d = displacements()[bucketForHash(h, displacementMask)];
+        const char *name = nameAtSlot(slotForHash(h, d, mask));
+        if (name  &&  0 == strcmp(name, key)) return name;
+        return nullptr;
+    }
+
+    const char *get(const char *key) const {
+        return get(key, baseHash(key));
+    }
+};
+
+#endif
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2017 Apple Inc.  All Rights Reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/***********************************************************************
+* objc-slab.mm
+* Size-class slab allocation for instances of opted-in classes.
+*
+* Classes opt in with objc_setClassUsesSlab(). Their instances of up to
+* SLAB_MAX_SIZE bytes are carved from 64 KB chunks of one reserved
+* address range. Each chunk holds a single size class, and
+* slab_owns() identifies slab memory with a range check, so
+* object_free() can tell slab objects from malloc objects without
+* reading the object's class.
+*
+* Slab instances are not malloc blocks. malloc_size() returns 0 for 
+* them and free() on them corrupts the heap. objc-internal.h warns 
+* callers of objc_setClassUsesSlab() about this.
+*
+* Each thread keeps a magazine of free objects per size class.
+* Allocation and free touch only the calling thread's magazine.
+* When a magazine runs dry it is refilled from the shared depot, and
+* when it fills up it is handed to the depot whole. The depot and the
+* chunk carver are protected by SlabLock, which is taken about once
+* per SLAB_MAGAZINE_SIZE allocations or frees.
+**********************************************************************/
+
+#include "objc-private.h"
+
+#include <sys/mman.h>
+
+#define SLAB_QUANTUM       16
+#define SLAB_SIZE_CLASSES  OBJC_SLAB_SIZE_CLASSES
+#define SLAB_MAX_SIZE      (SLAB_QUANTUM * SLAB_SIZE_CLASSES)
+#define SLAB_CHUNK_SHIFT   16
+#define SLAB_CHUNK_SIZE    (1UL << SLAB_CHUNK_SHIFT)
+#define SLAB_MAGAZINE_SIZE 64
+
+#if __LP64__
+#   define SLAB_REGION_SIZE (1UL << 30)
+#else
+#   define SLAB_REGION_SIZE (1UL << 26)
+#endif
+
+#define SLAB_CHUNK_COUNT (SLAB_REGION_SIZE >> SLAB_CHUNK_SHIFT)
+
+// A free object. The first word links free objects in a magazine.
+// The second word of a magazine's first object links full magazines
+// in the depot. Every size class is at least two words.
+struct slab_object_t {
+    slab_object_t *next;
+    slab_object_t *nextMagazine;
+};
+
+struct slab_magazine_t {
+    slab_object_t *head;
+    unsigned count;
+};
+
+struct SlabCache {
+    slab_magazine_t magazines[SLAB_SIZE_CLASSES];
+};
+
+struct slab_depot_t {
+    slab_object_t *fullMagazines;  // each exactly SLAB_MAGAZINE_SIZE long
+    slab_object_t *loose;          // freed without a thread cache
+    size_t looseCount;
+    uintptr_t carveNext;           // unused part of this class's last chunk
+    uintptr_t carveEnd;
+    size_t carved;                 // objects ever carved
+    size_t available;              // free objects held by the depot
+};
+
+uintptr_t SlabRegionStart;
+uintptr_t SlabRegionEnd;
+
+mutex_t SlabLock;
+
+static uintptr_t slabNextChunk;
+static slab_depot_t slabDepots[SLAB_SIZE_CLASSES];
+static uint8_t slabChunkClass[SLAB_CHUNK_COUNT];
+static size_t slabChunks;
+
+
+static inline unsigned slab_sizeClassForSize(size_t size)
+{
+    return (unsigned)((size + SLAB_QUANTUM - 1) / SLAB_QUANTUM) - 1;
+}
+
+static inline size_t slab_sizeForSizeClass(unsigned sizeClass)
+{
+    return (sizeClass + 1) * SLAB_QUANTUM;
+}
+
+static inline unsigned slab_sizeClassForObject(const void *ptr)
+{
+    return slabChunkClass[((uintptr_t)ptr - SlabRegionStart)
+                          >> SLAB_CHUNK_SHIFT];
+}
+
+
+// Reserve the address range on first use.
+// Pages are made accessible a chunk at a time.
+// Locking: SlabLock must be held by the caller.
+static bool slab_reserve_nolock(void)
+{
+    SlabLock.assertLocked();
+
+    if (SlabRegionStart) return true;
+
+    void *region = mmap(nil, SLAB_REGION_SIZE, PROT_NONE,
+                        MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (region == MAP_FAILED) return false;
+
+    slabNextChunk = (uintptr_t)region;
+    // slab_owns() reads these without a lock. 
+    // Publish End last so no reader sees End without Start.
+    SlabRegionStart = (uintptr_t)region;
+    __atomic_store_n(&SlabRegionEnd, (uintptr_t)region + SLAB_REGION_SIZE, 
+                     __ATOMIC_RELEASE);
+    return true;
+}
+
+
+// Carve up to one magazine of new objects for sizeClass.
+// Returns the number of objects carved into *outList.
+// Locking: SlabLock must be held by the caller.
+static unsigned slab_carve_nolock(unsigned sizeClass, slab_object_t **outList)
+{
+    SlabLock.assertLocked();
+
+    slab_depot_t& depot = slabDepots[sizeClass];
+    size_t size = slab_sizeForSizeClass(sizeClass);
+
+    if (depot.carveNext + size > depot.carveEnd) {
+        if (!slab_reserve_nolock()) return 0;
+        if (slabNextChunk + SLAB_CHUNK_SIZE > SlabRegionEnd) return 0;
+
+        uintptr_t chunk = slabNextChunk;
+        if (mprotect((void *)chunk, SLAB_CHUNK_SIZE,
+                     PROT_READ | PROT_WRITE) != 0)
+        {
+            return 0;
+        }
+        slabNextChunk += SLAB_CHUNK_SIZE;
+        slabChunkClass[(chunk - SlabRegionStart) >> SLAB_CHUNK_SHIFT] =
+            (uint8_t)sizeClass;
+        slabChunks++;
+
+        depot.carveNext = chunk;
+        depot.carveEnd = chunk + SLAB_CHUNK_SIZE;
+    }
+
+    slab_object_t *list = nil;
+    unsigned count = 0;
+    while (count < SLAB_MAGAZINE_SIZE  &&
+           depot.carveNext + size <= depot.carveEnd)
+    {
+        slab_object_t *obj = (slab_object_t *)depot.carveNext;
+        obj->next = list;
+        list = obj;
+        depot.carveNext += size;
+        count++;
+    }
+
+    depot.carved += count;
+    *outList = list;
+    return count;
+}
+
+
+// Load a magazine with free objects for sizeClass.
+// Prefers a full magazine from the depot, then loose objects,
+// then newly carved objects.
+static void slab_refill(unsigned sizeClass, slab_magazine_t *mag)
+{
+    mutex_locker_t lock(SlabLock);
+    slab_depot_t& depot = slabDepots[sizeClass];
+
+    if (depot.fullMagazines) {
+        slab_object_t *head = depot.fullMagazines;
+        depot.fullMagazines = head->nextMagazine;
+        depot.available -= SLAB_MAGAZINE_SIZE;
+        mag->head = head;
+        mag->count = SLAB_MAGAZINE_SIZE;
+        return;
+    }
+
+    if (depot.loose) {
+        slab_object_t *list = nil;
+        unsigned count = 0;
+        while (depot.loose  &&  count < SLAB_MAGAZINE_SIZE) {
+            slab_object_t *obj = depot.loose;
+            depot.loose = obj->next;
+            obj->next = list;
+            list = obj;
+            count++;
+        }
+        depot.looseCount -= count;
+        depot.available -= count;
+        mag->head = list;
+        mag->count = count;
+        return;
+    }
+
+    mag->count = slab_carve_nolock(sizeClass, &mag->head);
+}
+
+
+// Hand a full magazine to the depot.
+static void slab_flush(unsigned sizeClass, slab_magazine_t *mag)
+{
+    assert(mag->count == SLAB_MAGAZINE_SIZE);
+
+    mutex_locker_t lock(SlabLock);
+    slab_depot_t& depot = slabDepots[sizeClass];
+
+    mag->head->nextMagazine = depot.fullMagazines;
+    depot.fullMagazines = mag->head;
+    depot.available += SLAB_MAGAZINE_SIZE;
+
+    mag->head = nil;
+    mag->count = 0;
+}
+
+
+// Return a list of free objects to the depot's loose list.
+// Locking: SlabLock must be held by the caller.
+static void slab_addLoose_nolock(unsigned sizeClass,
+                                 slab_object_t *list, unsigned count)
+{
+    SlabLock.assertLocked();
+
+    slab_depot_t& depot = slabDepots[sizeClass];
+    while (list) {
+        slab_object_t *next = list->next;
+        list->next = depot.loose;
+        depot.loose = list;
+        list = next;
+    }
+    depot.looseCount += count;
+    depot.available += count;
+}
+
+
+static SlabCache *slab_cache(bool create)
+{
+    _objc_pthread_data *data = _objc_fetch_pthread_data(create);
+    if (!data) return nil;
+
+    SlabCache *cache = data->slabCache;
+    if (!cache  &&  create) {
+        cache = (SlabCache *)calloc(1, sizeof(SlabCache));
+        data->slabCache = cache;
+    }
+    return cache;
+}
+
+
+/***********************************************************************
+* slab_calloc
+* Returns zero-filled memory of at least size bytes from the slab,
+* or nil if size is too large or the slab region is exhausted.
+* Locking: may acquire SlabLock
+**********************************************************************/
+void *slab_calloc(size_t size)
+{
+    if (size > SLAB_MAX_SIZE) return nil;
+
+    SlabCache *cache = slab_cache(true);
+    if (!cache) return nil;
+
+    unsigned sizeClass = slab_sizeClassForSize(size);
+    slab_magazine_t *mag = &cache->magazines[sizeClass];
+    if (slowpath(!mag->head)) {
+        slab_refill(sizeClass, mag);
+        if (!mag->head) return nil;
+    }
+
+    slab_object_t *obj = mag->head;
+    mag->head = obj->next;
+    mag->count--;
+
+    bzero(obj, slab_sizeForSizeClass(sizeClass));
+    return obj;
+}
+
+
+/***********************************************************************
+* slab_free
+* Returns slab memory to the calling thread's magazine.
+* ptr must be slab memory; see slab_owns().
+* Locking: may acquire SlabLock
+**********************************************************************/
+void slab_free(void *ptr)
+{
+    assert(slab_owns(ptr));
+
+    unsigned sizeClass = slab_sizeClassForObject(ptr);
+    slab_object_t *obj = (slab_object_t *)ptr;
+
+    // Don't create a thread cache here. This thread may be exiting
+    // and its per-thread data may already be gone.
+    SlabCache *cache = slab_cache(false);
+    if (!cache) {
+        obj->next = nil;
+        mutex_locker_t lock(SlabLock);
+        slab_addLoose_nolock(sizeClass, obj, 1);
+        return;
+    }
+
+    slab_magazine_t *mag = &cache->magazines[sizeClass];
+    if (slowpath(mag->count == SLAB_MAGAZINE_SIZE)) {
+        slab_flush(sizeClass, mag);
+    }
+
+    obj->next = mag->head;
+    mag->head = obj;
+    mag->count++;
+}
+
+
+/***********************************************************************
+* _destroySlabCache
+* Returns a dying thread's magazines to the depot.
+* Locking: acquires SlabLock
+**********************************************************************/
+void _destroySlabCache(struct SlabCache *cache)
+{
+    if (!cache) return;
+
+    {
+        mutex_locker_t lock(SlabLock);
+        for (unsigned i = 0; i < SLAB_SIZE_CLASSES; i++) {
+            slab_magazine_t *mag = &cache->magazines[i];
+            if (mag->head) slab_addLoose_nolock(i, mag->head, mag->count);
+        }
+    }
+
+    free(cache);
+}
+
+
+/***********************************************************************
+* _objc_getSlabStats
+* Reports slab occupancy.
+* Objects that are carved but not available from the depot are either
+* live or cached by some thread's magazine.
+* Locking: acquires SlabLock
+**********************************************************************/
+void _objc_getSlabStats(struct objc_slab_stats *stats)
+{
+    if (!stats) return;
+
+    mutex_locker_t lock(SlabLock);
+
+    stats->chunks = slabChunks;
+    stats->chunkSize = SLAB_CHUNK_SIZE;
+    for (unsigned i = 0; i < SLAB_SIZE_CLASSES; i++) {
+        stats->carved[i] = slabDepots[i].carved;
+        stats->available[i] = slabDepots[i].available;
+    }
+}
@@ -71,6 +71,27 @@ static StripedMap<SyncList> sDataLists;
 
 enum usage { ACQUIRE, RELEASE, CHECK };
 
+
+/*
+  Statistics for _objc_sync_getStats(). 
+  Recorded only when OBJC_DEBUG_SYNC_STATS is set, to keep 
+  the shared counters' cache lines out of the fast paths.
+ */
+static struct objc_sync_stats sSyncStats;
+
+#define SYNC_STAT(field)                                        \
+    do {                                                        \
+        if (slowpath(DebugSyncStats)) {                         \
+            OSAtomicIncrement64((int64_t *)&sSyncStats.field);  \
+        }                                                       \
+    } while (0)
+
+void _objc_sync_getStats(struct objc_sync_stats *stats)
+{
+    if (!stats) return;
+    *stats = sSyncStats;
+}
+
 static SyncCache *fetch_cache(bool create)
 {
     _objc_pthread_data *data;
@@ -124,6 +145,8 @@ static SyncData* id2data(id object, enum usage why)
             // Found a match in fast cache.
             uintptr_t lockCount;
 
+            SYNC_STAT(fastCacheHits);
+
             result = data;
             lockCount = (uintptr_t)tls_get_direct(SYNC_COUNT_DIRECT_KEY);
             if (result->threadCount <= 0  ||  lockCount <= 0) {
@@ -165,6 +188,7 @@ static SyncData* id2data(id object, enum usage why)
             if (item->data->object != object) continue;
 
             // Found a match.
+            SYNC_STAT(threadCacheHits);
             result = item->data;
             if (result->threadCount <= 0  ||  item->lockCount <= 0) {
                 _objc_fatal("id2data cache is buggy");
@@ -199,6 +223,7 @@ static SyncData* id2data(id object, enum usage why)
     // We could keep the nodes in some hash table if we find that there are
     // more than 20 or so distinct locks active, but we don't do that now.
     
+    SYNC_STAT(listSearches);
     lockp->lock();
 
     {
@@ -278,6 +303,36 @@ BREAKPOINT_FUNCTION(
 );
 
 
+// Number of tryLock attempts before a contended objc_sync_enter blocks.
+#define SYNC_SPIN_COUNT 100
+
+static inline void sync_spin_pause(void)
+{
+#if __x86_64__  ||  __i386__
+    __asm__ __volatile__ ("pause");
+#elif __arm__  ||  __arm64__
+    __asm__ __volatile__ ("yield");
+#endif
+}
+
+// Slow path of objc_sync_enter: the mutex is held by another thread.
+// Most @synchronized sections are short, so spin briefly in case the 
+// owner releases the lock before blocking in the kernel.
+static NEVER_INLINE void sync_lock_contended(SyncData *data)
+{
+    for (unsigned i = 0; i < SYNC_SPIN_COUNT; i++) {
+        sync_spin_pause();
+        if (data->mutex.tryLock()) {
+            SYNC_STAT(spinAcquires);
+            return;
+        }
+    }
+
+    SYNC_STAT(blockingAcquires);
+    data->mutex.lock();
+}
+
+
 // Begin synchronizing on 'obj'. 
 // Allocates recursive mutex associated with 'obj' if needed.
 // Returns OBJC_SYNC_SUCCESS once lock is acquired.  
@@ -288,7 +343,11 @@ int objc_sync_enter(id obj)
     if (obj) {
         SyncData* data = id2data(obj, ACQUIRE);
         assert(data);
-        data->mutex.lock();
+        if (fastpath(data->mutex.tryLock())) {
+            SYNC_STAT(uncontendedAcquires);
+        } else {
+            sync_lock_contended(data);
+        }
     } else {
         // @synchronized(nil) does nothing
         if (DebugNilSync) {
@@ -104,188 +104,440 @@ static const char *	SkipFirstType	   (const char *	type)
 
 
 /***********************************************************************
-* encoding_getNumberOfArguments.
+* Parsed method signatures.
+* Method type strings in immutable image memory are parsed once into a 
+* method_signature_t and memoized in an open-addressed table keyed by 
+* the string's address. Records are immutable and never freed once 
+* installed, so lookups take no locks. Insertions take 
+* MethodSignatureLock. A full table is replaced by a larger copy, and 
+* the old table is leaked because readers may still be probing it.
+* Any other type string may be freed and its address reused, so it is 
+* parsed into a temporary record on every call and never cached. The 
+* temporary record lives in the caller's method_signature_buffer_t 
+* unless it has too many arguments to fit.
+* Once the table reaches METHOD_SIGNATURE_TABLE_MAX_SIZE, signatures 
+* are parsed into a temporary record and not cached.
 **********************************************************************/
-unsigned int 
-encoding_getNumberOfArguments(const char *typedesc)
+struct method_signature_arg_t {
+    uint32_t typeStart;   // index of the argument's type in types
+    uint32_t typeLength;
+    int frameOffset;      // offset as written in the type string
+    uint32_t size;        // 0 if the encoding does not give the layout
+    uint32_t alignment;   // 0 if the encoding does not give the layout
+};
+
+struct method_signature_t {
+    const char *types;    // the string this was parsed from
+    uint32_t returnLength;
+    uint32_t sizeOfArguments;
+    uint32_t argCount;
+    bool allocated;       // temporary heap record; freed by release
+    method_signature_arg_t args[0];
+};
+
+#define METHOD_SIGNATURE_BUFFER_ARGS 16
+
+// Caller-provided space for a temporary record.
+struct method_signature_buffer_t {
+    alignas(method_signature_t) uint8_t 
+        bytes[sizeof(method_signature_t) + 
+              METHOD_SIGNATURE_BUFFER_ARGS * sizeof(method_signature_arg_t)];
+};
+
+struct method_signature_table_t {
+    uint32_t mask;
+    uint32_t count;  // protected by MethodSignatureLock
+    method_signature_t *slots[0];
+};
+
+#define METHOD_SIGNATURE_TABLE_INITIAL_SIZE 256  // power of 2
+#define METHOD_SIGNATURE_TABLE_MAX_SIZE 65536
+
+mutex_t MethodSignatureLock;
+static method_signature_table_t *MethodSignatureTable;
+
+
+// Parse a (possibly negative) decimal number.
+static const char *ParseOffset(const char *type, int *outValue)
 {
-    unsigned nargs;
+    bool negative = NO;
+    int value = 0;
 
-    // First, skip the return type
-    typedesc = SkipFirstType (typedesc);
+    if (*type == '-') {
+        negative = YES;
+        type += 1;
+    }
+    while ((*type >= '0') && (*type <= '9'))
+        value = value * 10 + (*type++ - '0');
 
-    // Next, skip stack size
-    while ((*typedesc >= '0') && (*typedesc <= '9'))
-        typedesc += 1;
+    *outValue = negative ? -value : value;
+    return type;
+}
 
-    // Now, we have the arguments - count how many
-    nargs = 0;
-    while (*typedesc)
-    {
-        // Traverse argument type
-        typedesc = SkipFirstType (typedesc);
 
-        // Skip GNU runtime's register parameter hint
-        if (*typedesc == '+') typedesc++;
+// Alignment of T as a struct member, which is what 
+// type encodings describe. (i386 aligns double members to 4.)
+template <typename T> struct encoding_alignment_t { char c; T value; };
+#define ENCODING_ALIGNOF(T) \
+    ((uint32_t)offsetof(encoding_alignment_t<T>, value))
 
-        // Traverse (possibly negative) argument offset
-        if (*typedesc == '-')
-            typedesc += 1;
-        while ((*typedesc >= '0') && (*typedesc <= '9'))
-            typedesc += 1;
+/***********************************************************************
+* TypeLayout.
+* Size and alignment of the first type in type. Both are 0 if the 
+* encoding does not give the layout, as for void, bitfields, and 
+* structs whose fields are not encoded.
+**********************************************************************/
+static void TypeLayout(const char *type, uint32_t *outSize, 
+                       uint32_t *outAlignment)
+{
+    uint32_t size = 0;
+    uint32_t alignment = 0;
+
+    // Skip qualifiers.
+    while (*type  &&  strchr("AOnoNrV", *type)) type++;
+
+#define TYPE_LAYOUT(T) size = sizeof(T); alignment = ENCODING_ALIGNOF(T)
+    switch (*type) {
+    case 'c': case 'C': TYPE_LAYOUT(char); break;
+    case 'B': TYPE_LAYOUT(bool); break;
+    case 's': case 'S': TYPE_LAYOUT(short); break;
+    case 'i': case 'I': TYPE_LAYOUT(int); break;
+    // 'l' is always 32 bits. 64-bit long is encoded as 'q'.
+    case 'l': case 'L': TYPE_LAYOUT(int32_t); break;
+    case 'q': case 'Q': TYPE_LAYOUT(long long); break;
+    case 'f': TYPE_LAYOUT(float); break;
+    case 'd': TYPE_LAYOUT(double); break;
+    case 'D': TYPE_LAYOUT(long double); break;
+    case '*': case '@': case '#': case ':': case '^': 
+        TYPE_LAYOUT(void *); 
+        break;
+
+    case 'j': {
+        // _Complex
+        TypeLayout(type + 1, &size, &alignment);
+        size *= 2;
+        break;
+    }
 
-        // Made it past an argument
-        nargs += 1;
+    case '[': {
+        uint32_t count = 0;
+        type++;
+        while ((*type >= '0') && (*type <= '9'))
+            count = count * 10 + (*type++ - '0');
+        TypeLayout(type, &size, &alignment);
+        size *= count;
+        break;
     }
 
-    return nargs;
+    case '{': case '(': {
+        bool isUnion = (*type == '(');
+        char close = isUnion ? ')' : '}';
+        const char *end = type + 1 + SubtypeUntil(type + 1, close);
+        const char *field = type + 1;
+        while (field < end  &&  *field != '=') field++;
+        if (field == end) break;  // no field list
+        field++;
+
+        uint32_t offset = 0;
+        while (field < end) {
+            // Skip the field name, if any.
+            if (*field == '"') {
+                field = strchr(field + 1, '"');
+                if (!field  ||  field >= end) { alignment = 0; break; }
+                field++;
+            }
+
+            uint32_t fieldSize, fieldAlignment;
+            TypeLayout(field, &fieldSize, &fieldAlignment);
+            if (fieldAlignment == 0) { alignment = 0; break; }
+            if (isUnion) {
+                offset = MAX(offset, fieldSize);
+            } else {
+                offset = (offset + fieldAlignment - 1) & ~(fieldAlignment-1);
+                offset += fieldSize;
+            }
+            alignment = MAX(alignment, fieldAlignment);
+            field = SkipFirstType(field);
+        }
+        if (alignment) {
+            size = (offset + alignment - 1) & ~(alignment - 1);
+        }
+        break;
+    }
+
+    default:
+        // void, bitfields, and unknown types
+        break;
+    }
+#undef TYPE_LAYOUT
+
+    if (alignment == 0) size = 0;
+    *outSize = size;
+    *outAlignment = alignment;
 }
 
-/***********************************************************************
-* encoding_getSizeOfArguments.
-**********************************************************************/
-unsigned 
-encoding_getSizeOfArguments(const char *typedesc)
+
+// Parses typedesc into buffer if it fits, or into a new heap record.
+static method_signature_t *
+method_signature_create(const char *typedesc, 
+                        method_signature_buffer_t *buffer)
 {
-    unsigned		stack_size;
+    const char *t;
+    unsigned nargs = 0;
 
-    // Get our starting points
-    stack_size = 0;
+    // Count the arguments so the record can be allocated in one piece.
+    t = SkipFirstType (typedesc);
+    while ((*t >= '0') && (*t <= '9'))
+        t += 1;
+    while (*t) {
+        int ignored;
+        t = SkipFirstType (t);
+        // Skip GNU runtime's register parameter hint
+        if (*t == '+') t++;
+        t = ParseOffset(t, &ignored);
+        nargs += 1;
+    }
 
-    // Skip the return type
-    typedesc = SkipFirstType (typedesc);
+    size_t size = sizeof(method_signature_t) + 
+        nargs * sizeof(method_signature_arg_t);
+    method_signature_t *sig;
+    if (buffer  &&  size <= sizeof(buffer->bytes)) {
+        sig = (method_signature_t *)buffer->bytes;
+        sig->allocated = NO;
+    } else {
+        sig = (method_signature_t *)malloc(size);
+        sig->allocated = YES;
+    }
+
+    sig->types = typedesc;
+    sig->argCount = nargs;
+
+    t = SkipFirstType (typedesc);
+    sig->returnLength = (uint32_t)(t - typedesc);
 
     // Convert ASCII number string to integer
-    while ((*typedesc >= '0') && (*typedesc <= '9'))
-        stack_size = (stack_size * 10) + (*typedesc++ - '0');
+    sig->sizeOfArguments = 0;
+    while ((*t >= '0') && (*t <= '9'))
+        sig->sizeOfArguments = (sig->sizeOfArguments * 10) + (*t++ - '0');
+
+    for (unsigned i = 0; i < nargs; i++) {
+        method_signature_arg_t& arg = sig->args[i];
+        const char *end = SkipFirstType (t);
+        arg.typeStart = (uint32_t)(t - typedesc);
+        arg.typeLength = (uint32_t)(end - t);
+        TypeLayout(t, &arg.size, &arg.alignment);
+        t = end;
+        if (*t == '+') t++;
+        t = ParseOffset(t, &arg.frameOffset);
+    }
 
-    return stack_size;
+    return sig;
 }
 
 
-/***********************************************************************
-* encoding_getArgumentInfo.
-**********************************************************************/
-unsigned int 
-encoding_getArgumentInfo(const char *typedesc, unsigned int arg,
-                         const char **type, int *offset)
+static inline uintptr_t method_signature_hash(const char *typedesc)
 {
-    unsigned nargs = 0;
-    int self_offset = 0;
-    bool offset_is_negative = NO;
+    uintptr_t h = (uintptr_t)typedesc;
+    return (h >> 3) ^ (h >> 13);
+}
 
-    // First, skip the return type
-    typedesc = SkipFirstType (typedesc);
 
-    // Next, skip stack size
-    while ((*typedesc >= '0') && (*typedesc <= '9'))
-        typedesc += 1;
+// Returns typedesc's record in table, or nil.
+// Locking: none
+static method_signature_t *
+method_signature_find(method_signature_table_t *table, const char *typedesc)
+{
+    if (!table) return nil;
+
+    // The table is never more than half full, so the probe ends.
+    for (uintptr_t i = method_signature_hash(typedesc); ; i++) {
+        method_signature_t *sig = 
+            __atomic_load_n(&table->slots[i & table->mask], __ATOMIC_ACQUIRE);
+        if (!sig) return nil;
+        if (sig->types == typedesc) return sig;
+    }
+}
 
-    // Now, we have the arguments - position typedesc to the appropriate argument
-    while (*typedesc && nargs != arg)
-    {
 
-        // Skip argument type
-        typedesc = SkipFirstType (typedesc);
+// Locking: MethodSignatureLock must be held by the caller.
+static void method_signature_insert(method_signature_table_t *table, 
+                                    method_signature_t *sig)
+{
+    MethodSignatureLock.assertLocked();
 
-        if (nargs == 0)
-        {
-            // Skip GNU runtime's register parameter hint
-            if (*typedesc == '+') typedesc++;
-
-            // Skip negative sign in offset
-            if (*typedesc == '-')
-            {
-                offset_is_negative = YES;
-                typedesc += 1;
-            }
-            else
-                offset_is_negative = NO;
+    uintptr_t i = method_signature_hash(sig->types);
+    while (table->slots[i & table->mask]) i++;
+    __atomic_store_n(&table->slots[i & table->mask], sig, __ATOMIC_RELEASE);
+    table->count++;
+}
 
-            while ((*typedesc >= '0') && (*typedesc <= '9'))
-                self_offset = self_offset * 10 + (*typedesc++ - '0');
-            if (offset_is_negative)
-                self_offset = -(self_offset);
 
+// Publishes a table twice the size of the current one, or a first table.
+// Returns nil if the table is already at its maximum size.
+// Locking: MethodSignatureLock must be held by the caller.
+static method_signature_table_t *method_signature_table_grow(void)
+{
+    MethodSignatureLock.assertLocked();
+
+    method_signature_table_t *oldTable = MethodSignatureTable;
+    size_t newSize = oldTable 
+        ? (oldTable->mask + 1) * 2 : METHOD_SIGNATURE_TABLE_INITIAL_SIZE;
+    if (newSize > METHOD_SIGNATURE_TABLE_MAX_SIZE) return nil;
+
+    method_signature_table_t *table = (method_signature_table_t *)
+        calloc(sizeof(method_signature_table_t) + 
+               newSize * sizeof(method_signature_t *), 1);
+    table->mask = (uint32_t)(newSize - 1);
+    if (oldTable) {
+        for (uint32_t i = 0; i <= oldTable->mask; i++) {
+            if (oldTable->slots[i]) {
+                method_signature_insert(table, oldTable->slots[i]);
+            }
         }
+    }
 
-        else
-        {
-            // Skip GNU runtime's register parameter hint
-            if (*typedesc == '+') typedesc++;
-
-            // Skip (possibly negative) argument offset
-            if (*typedesc == '-')
-                typedesc += 1;
-            while ((*typedesc >= '0') && (*typedesc <= '9'))
-                typedesc += 1;
-        }
+    // oldTable is never freed. Readers may still be probing it.
+    __atomic_store_n(&MethodSignatureTable, table, __ATOMIC_RELEASE);
+    return table;
+}
 
-        nargs += 1;
+
+/***********************************************************************
+* method_signature_get
+* Returns the parsed signature of typedesc. The result may live in 
+* buffer, so it must not outlive it.
+* Call method_signature_release() when done with the result.
+* Locking: acquires MethodSignatureLock on a miss
+**********************************************************************/
+static method_signature_t *
+method_signature_get(const char *typedesc, method_signature_buffer_t *buffer)
+{
+    method_signature_t *sig = method_signature_find
+        (__atomic_load_n(&MethodSignatureTable, __ATOMIC_ACQUIRE), typedesc);
+    if (fastpath(sig)) return sig;
+
+    // Only strings that can never be freed are cached.
+    if (!_dyld_is_memory_immutable(typedesc, strlen(typedesc) + 1)) {
+        return method_signature_create(typedesc, buffer);
     }
 
-    if (*typedesc)
-    {
-        int arg_offset = 0;
+    sig = method_signature_create(typedesc, nil);
 
-        *type	 = typedesc;
-        typedesc = SkipFirstType (typedesc);
+    mutex_locker_t lock(MethodSignatureLock);
 
-        if (arg == 0)
-        {
-            *offset = 0;
-        }
+    method_signature_table_t *table = MethodSignatureTable;
+    method_signature_t *existing = method_signature_find(table, typedesc);
+    if (existing) {
+        // Another thread installed it first.
+        free(sig);
+        return existing;
+    }
 
-        else
-        {
-            // Skip GNU register parameter hint
-            if (*typedesc == '+') typedesc++;
-
-            // Pick up (possibly negative) argument offset
-            if (*typedesc == '-')
-            {
-                offset_is_negative = YES;
-                typedesc += 1;
-            }
-            else
-                offset_is_negative = NO;
+    if (!table  ||  (table->count + 1) * 2 > table->mask + 1) {
+        table = method_signature_table_grow();
+        // No room. Caller frees it.
+        if (!table) return sig;
+    }
 
-            while ((*typedesc >= '0') && (*typedesc <= '9'))
-                arg_offset = arg_offset * 10 + (*typedesc++ - '0');
-            if (offset_is_negative)
-                arg_offset = - arg_offset;
+    sig->allocated = NO;
+    method_signature_insert(table, sig);
+    return sig;
+}
 
-            *offset = arg_offset - self_offset;
-        }
 
-    }
+static inline void method_signature_release(method_signature_t *sig)
+{
+    if (sig->allocated) free(sig);
+}
 
-    else
-    {
+
+/***********************************************************************
+* encoding_getNumberOfArguments.
+**********************************************************************/
+unsigned int 
+encoding_getNumberOfArguments(const char *typedesc)
+{
+    method_signature_buffer_t buffer;
+    method_signature_t *sig = method_signature_get(typedesc, &buffer);
+    unsigned nargs = sig->argCount;
+    method_signature_release(sig);
+    return nargs;
+}
+
+/***********************************************************************
+* encoding_getSizeOfArguments.
+**********************************************************************/
+unsigned 
+encoding_getSizeOfArguments(const char *typedesc)
+{
+    method_signature_buffer_t buffer;
+    method_signature_t *sig = method_signature_get(typedesc, &buffer);
+    unsigned stack_size = sig->sizeOfArguments;
+    method_signature_release(sig);
+    return stack_size;
+}
+
+
+/***********************************************************************
+* encoding_getArgumentInfo.
+**********************************************************************/
+unsigned int 
+encoding_getArgumentInfo(const char *typedesc, unsigned int arg,
+                         const char **type, int *offset)
+{
+    method_signature_buffer_t buffer;
+    method_signature_t *sig = method_signature_get(typedesc, &buffer);
+    unsigned nargs;
+
+    if (arg < sig->argCount) {
+        *type = typedesc + sig->args[arg].typeStart;
+        if (arg == 0) *offset = 0;
+        else *offset = sig->args[arg].frameOffset - sig->args[0].frameOffset;
+        nargs = arg;
+    }
+    else {
         *type	= 0;
         *offset	= 0;
+        nargs = sig->argCount;
     }
 
+    method_signature_release(sig);
     return nargs;
 }
 
 
+// Copy len bytes of a type string into dst, zero-filling the rest.
+static void encoding_copyTypeInto(const char *t, size_t len, 
+                                  char *dst, size_t dst_len)
+{
+    strncpy(dst, t, MIN(len, dst_len));
+    if (len < dst_len) memset(dst+len, 0, dst_len - len);
+}
+
+
+// Copy len bytes of a type string to the heap.
+static char *encoding_copyType(const char *t, size_t len)
+{
+    char *result = (char *)malloc(len + 1);
+    strncpy(result, t, len);
+    result[len] = '\0';
+    return result;
+}
+
+
 void 
 encoding_getReturnType(const char *t, char *dst, size_t dst_len)
 {
-    size_t len;
-    const char *end;
-
     if (!dst) return;
     if (!t) {
         strncpy(dst, "", dst_len);
         return;
     }
 
-    end = SkipFirstType(t);
-    len = end - t;
-    strncpy(dst, t, MIN(len, dst_len));
-    if (len < dst_len) memset(dst+len, 0, dst_len - len);
+    method_signature_buffer_t buffer;
+    method_signature_t *sig = method_signature_get(t, &buffer);
+    encoding_copyTypeInto(t, sig->returnLength, dst, dst_len);
+    method_signature_release(sig);
 }
 
 /***********************************************************************
@@ -295,17 +547,12 @@ encoding_getReturnType(const char *t, char *dst, size_t dst_len)
 char *
 encoding_copyReturnType(const char *t)
 {
-    size_t len;
-    const char *end;
-    char *result;
-
     if (!t) return NULL;
 
-    end = SkipFirstType(t);
-    len = end - t;
-    result = (char *)malloc(len + 1);
-    strncpy(result, t, len);
-    result[len] = '\0';
+    method_signature_buffer_t buffer;
+    method_signature_t *sig = method_signature_get(t, &buffer);
+    char *result = encoding_copyType(t, sig->returnLength);
+    method_signature_release(sig);
     return result;
 }
 
@@ -314,27 +561,21 @@ void
 encoding_getArgumentType(const char *t, unsigned int index, 
                          char *dst, size_t dst_len)
 {
-    size_t len;
-    const char *end;
-    int offset;
-
     if (!dst) return;
     if (!t) {
         strncpy(dst, "", dst_len);
         return;
     }
 
-    encoding_getArgumentInfo(t, index, &t, &offset);
-
-    if (!t) {
+    method_signature_buffer_t buffer;
+    method_signature_t *sig = method_signature_get(t, &buffer);
+    if (index < sig->argCount) {
+        const method_signature_arg_t& arg = sig->args[index];
+        encoding_copyTypeInto(t + arg.typeStart, arg.typeLength, dst, dst_len);
+    } else {
         strncpy(dst, "", dst_len);
-        return;
     }
-
-    end = SkipFirstType(t);
-    len = end - t;
-    strncpy(dst, t, MIN(len, dst_len));
-    if (len < dst_len) memset(dst+len, 0, dst_len - len);
+    method_signature_release(sig);
 }
 
 
@@ -345,21 +586,38 @@ encoding_getArgumentType(const char *t, unsigned int index,
 char *
 encoding_copyArgumentType(const char *t, unsigned int index)
 {
-    size_t len;
-    const char *end;
-    char *result;
-    int offset;
-
     if (!t) return NULL;
 
-    encoding_getArgumentInfo(t, index, &t, &offset);
+    char *result = NULL;
+    method_signature_buffer_t buffer;
+    method_signature_t *sig = method_signature_get(t, &buffer);
+    if (index < sig->argCount) {
+        const method_signature_arg_t& arg = sig->args[index];
+        result = encoding_copyType(t + arg.typeStart, arg.typeLength);
+    }
+    method_signature_release(sig);
+    return result;
+}
 
-    if (!t) return NULL;
 
-    end = SkipFirstType(t);
-    len = end - t;
-    result = (char *)malloc(len + 1);
-    strncpy(result, t, len);
-    result[len] = '\0';
-    return result;
+/***********************************************************************
+* encoding_getArgumentLayout.  Returns the size and alignment of a 
+* single argument's type, as laid out in a C struct. Both are 0 if the 
+* argument does not exist or its encoding does not give the layout.
+**********************************************************************/
+void 
+encoding_getArgumentLayout(const char *t, unsigned int index, 
+                           size_t *size, size_t *alignment)
+{
+    *size = 0;
+    *alignment = 0;
+    if (!t) return;
+
+    method_signature_buffer_t buffer;
+    method_signature_t *sig = method_signature_get(t, &buffer);
+    if (index < sig->argCount) {
+        *size = sig->args[index].size;
+        *alignment = sig->args[index].alignment;
+    }
+    method_signature_release(sig);
 }
@@ -70,6 +70,9 @@ typedef DisguisedPtr<objc_object *> weak_referrer_t;
  */
 #define WEAK_INLINE_COUNT 4
 
+// Maximum number of referrers weak_clear_batch_no_lock clears at once.
+#define WEAK_CLEAR_BATCH_COUNT 256
+
 // out_of_line_ness field overlaps with the low two bits of inline_referrers[1].
 // inline_referrers[1] is a DisguisedPtr of a pointer-aligned address.
 // The low two bits of a pointer-aligned DisguisedPtr will always be 0b00
@@ -85,7 +88,14 @@ struct weak_entry_t {
             uintptr_t        out_of_line_ness : 2;
             uintptr_t        num_refs : PTR_MINUS_2;
             uintptr_t        mask;
+#if __LP64__
+            uintptr_t        max_hash_displacement : 32;
+            // next slot for weak_clear_batch_no_lock to look at
+            uintptr_t        clear_cursor : 32;
+#else
             uintptr_t        max_hash_displacement;
+            uintptr_t        clear_cursor;
+#endif
         };
         struct {
             // out_of_line_ness field is low bits of inline_referrers[1]
@@ -127,6 +137,10 @@ struct weak_table_t {
 id weak_register_no_lock(weak_table_t *weak_table, id referent, 
                          id *referrer, bool crashIfDeallocating);
 
+/// Adds an entry taken from another weak table. 
+/// The referent must not be in the table yet.
+void weak_move_entry_no_lock(weak_table_t *weak_table, weak_entry_t *entry);
+
 /// Removes an (object, weak pointer) pair from the weak table.
 void weak_unregister_no_lock(weak_table_t *weak_table, id referent, id *referrer);
 
@@ -138,6 +152,11 @@ bool weak_is_registered_no_lock(weak_table_t *weak_table, id referent);
 /// Called on object destruction. Sets all remaining weak pointers to nil.
 void weak_clear_no_lock(weak_table_t *weak_table, id referent);
 
+/// Called on object destruction. Sets a batch of remaining weak pointers 
+/// to nil. Returns true once no weak pointers remain. The caller may 
+/// release the weak table's lock between calls.
+bool weak_clear_batch_no_lock(weak_table_t *weak_table, id referent);
+
 __END_DECLS
 
 #endif /* _OBJC_WEAK_H_ */
@@ -89,6 +89,7 @@ static void grow_refs_and_insert(weak_entry_t *entry,
         calloc(TABLE_SIZE(entry), sizeof(weak_referrer_t));
     entry->num_refs = 0;
     entry->max_hash_displacement = 0;
+    entry->clear_cursor = 0;
     
     for (size_t i = 0; i < old_size && num_refs > 0; i++) {
         if (old_refs[i] != nil) {
@@ -133,6 +134,7 @@ static void append_referrer(weak_entry_t *entry, objc_object **new_referrer)
         entry->out_of_line_ness = REFERRERS_OUT_OF_LINE;
         entry->mask = WEAK_INLINE_COUNT-1;
         entry->max_hash_displacement = 0;
+        entry->clear_cursor = 0;
     }
 
     assert(entry->out_of_line());
@@ -267,6 +269,17 @@ static void weak_grow_maybe(weak_table_t *weak_table)
     }
 }
 
+/** 
+ * Add entry, taken from another weak table, to weak_table.
+ * Its out-of-line referrers move with it.
+ * Does not check whether the referent is already in the table.
+ */
+void weak_move_entry_no_lock(weak_table_t *weak_table, weak_entry_t *entry)
+{
+    weak_grow_maybe(weak_table);
+    weak_entry_insert(weak_table, entry);
+}
+
 // Shrink the table if it is mostly empty.
 static void weak_compact_maybe(weak_table_t *weak_table)
 {
@@ -452,14 +465,47 @@ weak_is_registered_no_lock(weak_table_t *weak_table, id referent_id)
 
 
 /** 
- * Called by dealloc; nils out all weak pointers that point to the 
- * provided object so that they can no longer be used.
+ * Nil out one weak pointer that pointed to a deallocating object.
+ */
+static inline void 
+weak_clear_referrer(objc_object **referrer, objc_object *referent)
+{
+    if (*referrer == referent) {
+        *referrer = nil;
+    }
+    else if (*referrer) {
+        _objc_inform("__weak variable at %p holds %p instead of %p. "
+                     "This is probably incorrect use of "
+                     "objc_storeWeak() and objc_loadWeak(). "
+                     "Break on objc_weak_error to debug.\n", 
+                     referrer, (void*)*referrer, (void*)referent);
+        objc_weak_error();
+    }
+}
+
+
+/** 
+ * Called by dealloc; nils out up to WEAK_CLEAR_BATCH_COUNT weak pointers 
+ * that point to the provided object. Cleared referrers are removed from 
+ * the entry, and the entry's clear_cursor records where the next call 
+ * resumes, so clearing n referrers takes O(n) time in total. 
+ * The referrer set is never rehashed while the referent is deallocating, 
+ * so the cursor stays valid when the entry moves or is looked up again.
+ * 
+ * The caller may drop the table's lock between calls. This is safe 
+ * because the referent is deallocating: weak_register_no_lock refuses 
+ * new referrers for it, so its referrer set only shrinks, and 
+ * weak_unregister_no_lock may remove the entry entirely in between. 
+ * The entry may move if the table is resized, so it is looked up again 
+ * on every call.
  * 
  * @param weak_table 
  * @param referent The object being deallocated. 
+ * 
+ * @return true if no weak pointers to referent remain.
  */
-void 
-weak_clear_no_lock(weak_table_t *weak_table, id referent_id) 
+bool 
+weak_clear_batch_no_lock(weak_table_t *weak_table, id referent_id) 
 {
     objc_object *referent = (objc_object *)referent_id;
 
@@ -467,39 +513,71 @@ weak_clear_no_lock(weak_table_t *weak_table, id referent_id)
     if (entry == nil) {
         /// XXX shouldn't happen, but does with mismatched CF/objc
         //printf("XXX no entry for clear deallocating %p\n", referent);
-        return;
+        return true;
     }
 
-    // zero out references
-    weak_referrer_t *referrers;
-    size_t count;
-    
-    if (entry->out_of_line()) {
-        referrers = entry->referrers;
-        count = TABLE_SIZE(entry);
-    } 
-    else {
-        referrers = entry->inline_referrers;
-        count = WEAK_INLINE_COUNT;
+    // Small sets are cleared in one pass.
+    if (! entry->out_of_line()  ||  entry->num_refs <= WEAK_CLEAR_BATCH_COUNT) 
+    {
+        weak_referrer_t *referrers;
+        size_t count;
+
+        if (entry->out_of_line()) {
+            referrers = entry->referrers;
+            count = TABLE_SIZE(entry);
+        } 
+        else {
+            referrers = entry->inline_referrers;
+            count = WEAK_INLINE_COUNT;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            objc_object **referrer = referrers[i];
+            if (referrer) weak_clear_referrer(referrer, referent);
+        }
+
+        weak_entry_remove(weak_table, entry);
+        return true;
     }
-    
-    for (size_t i = 0; i < count; ++i) {
-        objc_object **referrer = referrers[i];
+
+    // Large out-of-line set. Clear one batch and remove it from the set, 
+    // starting where the previous batch stopped.
+    size_t count = TABLE_SIZE(entry);
+    size_t cleared = 0;
+    size_t i;
+    for (i = entry->clear_cursor; 
+         i < count  &&  cleared < WEAK_CLEAR_BATCH_COUNT; 
+         ++i) 
+    {
+        objc_object **referrer = entry->referrers[i];
         if (referrer) {
-            if (*referrer == referent) {
-                *referrer = nil;
-            }
-            else if (*referrer) {
-                _objc_inform("__weak variable at %p holds %p instead of %p. "
-                             "This is probably incorrect use of "
-                             "objc_storeWeak() and objc_loadWeak(). "
-                             "Break on objc_weak_error to debug.\n", 
-                             referrer, (void*)*referrer, (void*)referent);
-                objc_weak_error();
-            }
+            weak_clear_referrer(referrer, referent);
+            entry->referrers[i] = nil;
+            entry->num_refs--;
+            cleared++;
         }
     }
-    
-    weak_entry_remove(weak_table, entry);
+    entry->clear_cursor = i;
+
+    if (entry->num_refs == 0) {
+        weak_entry_remove(weak_table, entry);
+        return true;
+    }
+    return false;
 }
 
+
+/** 
+ * Called by dealloc; nils out all weak pointers that point to the 
+ * provided object so that they can no longer be used.
+ * 
+ * @param weak_table 
+ * @param referent The object being deallocated. 
+ */
+void 
+weak_clear_no_lock(weak_table_t *weak_table, id referent_id) 
+{
+    while (! weak_clear_batch_no_lock(weak_table, referent_id)) {
+        // keep going
+    }
+}
@@ -0,0 +1,212 @@
+/*
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*
+  selopt
+  Build a precomputed selector table for one image.
+
+  usage: selopt [-o output.c] [names.txt]
+
+  Reads selector names, one per line, and writes C source defining a
+  __DATA,__objc_selopt section. Link the output into the image and the
+  runtime will use the table instead of registering each name at launch.
+  The table uses hash-and-displace: each name hashes to a bucket, and
+  each bucket stores one displacement that moves all of its names into
+  free slots. See runtime/objc-selopt.h for the layout and lookup.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "runtime/objc-selopt.h"
+
+static uint32_t roundUpPow2(uint32_t n)
+{
+    uint32_t result = 1;
+    while (result < n) result <<= 1;
+    return result;
+}
+
+struct bucket {
+    uint32_t index;
+    std::vector<uint32_t> names;
+};
+
+// Try to place every name using one salt and table size.
+// Returns false if some bucket finds no usable displacement.
+static bool build(const std::vector<std::string>& names, uint64_t salt,
+                  uint32_t mask, uint32_t displacementMask,
+                  std::vector<int32_t>& displacements,
+                  std::vector<int32_t>& slots)
+{
+    std::vector<uint64_t> hashes(names.size());
+    std::vector<bucket> buckets(displacementMask + 1);
+    for (uint32_t i = 0; i < buckets.size(); i++) buckets[i].index = i;
+    for (uint32_t i = 0; i < names.size(); i++) {
+        hashes[i] = objc_image_selopt_t::hash
+            (objc_image_selopt_t::baseHash(names[i].c_str()), salt);
+        uint32_t b =
+            objc_image_selopt_t::bucketForHash(hashes[i], displacementMask);
+        buckets[b].names.push_back(i);
+    }
+
+    // Place the largest buckets first while the table is emptiest.
+    std::stable_sort(buckets.begin(), buckets.end(),
+                     [](const bucket& a, const bucket& b) {
+                         return a.names.size() > b.names.size();
+                     });
+
+    displacements.assign(displacementMask + 1, 0);
+    slots.assign(mask + 1, -1);
+    std::vector<uint32_t> tried;
+
+    for (const bucket& b : buckets) {
+        if (b.names.empty()) break;
+        bool placed = false;
+        for (uint32_t d = 0; d <= mask  &&  !placed; d++) {
+            tried.clear();
+            placed = true;
+            for (uint32_t n : b.names) {
+                uint32_t slot =
+                    objc_image_selopt_t::slotForHash(hashes[n], d, mask);
+                if (slots[slot] >= 0  ||
+                    std::find(tried.begin(), tried.end(), slot) != tried.end())
+                {
+                    placed = false;
+                    break;
+                }
+                tried.push_back(slot);
+            }
+            if (placed) {
+                displacements[b.index] = (int32_t)d;
+                for (size_t i = 0; i < b.names.size(); i++) {
+                    slots[tried[i]] = (int32_t)b.names[i];
+                }
+            }
+        }
+        if (!placed) return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *outPath = nullptr;
+    const char *inPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "-o")  &&  i+1 < argc) outPath = argv[++i];
+        else if (!inPath) inPath = argv[i];
+        else {
+            fprintf(stderr, "usage: selopt [-o output.c] [names.txt]\n");
+            return 1;
+        }
+    }
+
+    FILE *in = inPath ? fopen(inPath, "r") : stdin;
+    if (!in) { perror(inPath); return 1; }
+
+    std::vector<std::string> names;
+    char *line = nullptr;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, in)) >= 0) {
+        while (len > 0  &&  (line[len-1] == '\n'  ||  line[len-1] == '\r')) {
+            line[--len] = 0;
+        }
+        if (len > 0) names.push_back(line);
+    }
+    free(line);
+    if (in != stdin) fclose(in);
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    if (names.empty()) {
+        fprintf(stderr, "selopt: no selector names\n");
+        return 1;
+    }
+
+    uint32_t count = (uint32_t)names.size();
+    uint32_t mask = roundUpPow2(count) - 1;
+    uint32_t displacementMask = roundUpPow2(std::max(count / 4, 1u)) - 1;
+    uint64_t salt = 0;
+    std::vector<int32_t> displacements;
+    std::vector<int32_t> slots;
+    for (unsigned attempt = 0;
+         !build(names, salt, mask, displacementMask, displacements, slots);
+         attempt++)
+    {
+        // Try a few salts, then give the table more room.
+        salt = salt * 6364136223846793005ULL + 1442695040888963407ULL;
+        if (attempt % 16 == 15) {
+            mask = mask * 2 + 1;
+            displacementMask = displacementMask * 2 + 1;
+        }
+    }
+
+    // Assemble the section contents.
+    objc_image_selopt_t header;
+    header.version = OBJC_IMAGE_SELOPT_VERSION;
+    header.count = count;
+    header.mask = mask;
+    header.displacementMask = displacementMask;
+    header.salt = salt;
+
+    std::vector<uint8_t> bytes(header.headerAndIndexSize());
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + sizeof(header), displacements.data(),
+           displacements.size() * sizeof(int32_t));
+    std::vector<int32_t> nameOffsets(names.size());
+    for (uint32_t i = 0; i < names.size(); i++) {
+        nameOffsets[i] = (int32_t)bytes.size();
+        bytes.insert(bytes.end(), names[i].begin(), names[i].end());
+        bytes.push_back(0);
+    }
+    uint8_t *offsets =
+        bytes.data() + sizeof(header) + displacements.size()*sizeof(int32_t);
+    for (uint32_t slot = 0; slot <= mask; slot++) {
+        int32_t n = slots[slot];
+        int32_t offset = (n < 0) ? 0 : nameOffsets[n];
+        memcpy(offsets + slot*sizeof(offset), &offset, sizeof(offset));
+    }
+
+    FILE *out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out) { perror(outPath); return 1; }
+
+    fprintf(out, "// Generated by selopt: %u selectors, %u slots.\n"
+            "// Do not edit.\n\n", count, mask + 1);
+    fprintf(out, "__attribute__((used, aligned(8), "
+            "section(\"__DATA,__objc_selopt\")))\n"
+            "static const unsigned char objc_image_selopt[%zu] = {",
+            bytes.size());
+    for (size_t i = 0; i < bytes.size(); i++) {
+        fprintf(out, "%s0x%02x,", (i % 12) ? " " : "\n    ", bytes[i]);
+    }
+    fprintf(out, "\n};\n");
+
+    if (out != stdout) fclose(out);
+    return 0;
+}